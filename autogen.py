@@ -1,5 +1,6 @@
 from pathlib import Path
 import glob
+import re
 
 print("")
 print("==========================================")
@@ -48,6 +49,60 @@ files = glob.glob('include/*.gen.h')
 for file in files:
     generateFile(file)
 
+# Binary log string table
+
+LOG_MACRO = re.compile(r'DEBUG_(INFO|WARN|ERROR)\(\s*((?:"(?:[^"\\]|\\.)*"\s*)+)')
+LOG_LITERAL = re.compile(r'"((?:[^"\\]|\\.)*)"')
+C_ESCAPES = {"n": "\n", "r": "\r", "t": "\t", "0": "\0", "\\": "\\", "\"": "\"", "'": "'", "a": "\a", "b": "\b"}
+
+def unescapeLiteral(text):
+    out = ""
+    i = 0
+    while i < len(text):
+        if text[i] == "\\" and i + 1 < len(text):
+            if text[i + 1] == "x":
+                digits = re.match(r"[0-9a-fA-F]+", text[i + 2:]).group(0)
+                out += chr(int(digits, 16))
+                i += 2 + len(digits)
+                continue
+            out += C_ESCAPES.get(text[i + 1], text[i + 1])
+            i += 2
+            continue
+        out += text[i]
+        i += 1
+    return out
+
+# must match logId() in lib/logformat.h
+def logId(fmt):
+    h = 2166136261
+    for c in fmt.encode("utf-8"):
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return (h >> 16) ^ (h & 0xFFFF)
+
+def escapeFormat(fmt):
+    return fmt.replace("\\", "\\\\").replace("\n", "\\n").replace("\r", "\\r").replace("\t", "\\t")
+
+print("Collecting binary log strings")
+logStrings = {}
+sources = glob.glob("*/**/*.cpp", recursive=True) + glob.glob("*/**/*.h", recursive=True)
+for source in sorted(sources):
+    f = open(source, "r")
+    text = f.read()
+    f.close()
+    for match in LOG_MACRO.finditer(text):
+        fmt = "".join(unescapeLiteral(part) for part in LOG_LITERAL.findall(match.group(2)))
+        id = logId(fmt)
+        line = text.count("\n", 0, match.start()) + 1
+        if id in logStrings and logStrings[id] != fmt:
+            print(source + ":" + str(line) + ":1: Error: log format ID collision with \"" + escapeFormat(logStrings[id]) + "\"")
+        logStrings[id] = fmt
+
+print("Generating logstrings.txt (" + str(len(logStrings)) + " strings)")
+f = open("include/logstrings.txt", "w")
+for id in sorted(logStrings):
+    f.write("%04x\t%s\n" % (id, escapeFormat(logStrings[id])))
+f.close()
+
 # Update config
 conf_defines["VERSION_32"] = str(int(conf_defines["VERSION_32"]) + 1)
     
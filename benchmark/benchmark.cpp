@@ -0,0 +1,413 @@
+#include <framework.h>
+#include <serialdebug.h>
+#include <clock.h>
+#include <timer.h>
+#include <pidcontroller.h>
+#include <i2c.h>
+#include <constants.h>
+#include <telemetry.h>
+#include <packet.h>
+#include <reliablelink.h>
+#include <packetscheduler.h>
+#include <ringbuffer.h>
+
+DebugInterface debug;
+
+Clock clock;
+
+#define BENCH_ITERATIONS 256
+
+// sinks keep the compiler from optimizing the benchmarked code away
+volatile float sinkFloat;
+volatile uint16_t sinkInt;
+volatile int32_t sinkFixed;
+volatile bool sinkBool;
+volatile ticks_t sourceTicks = 123456789UL;
+volatile float sourceFloat = 0.75f;
+volatile int32_t sourceFixed = Q16_16(0.75f).raw;
+
+// Returns the average number of CPU cycles of one call to fn (loop overhead included)
+template <typename F>
+static uint32_t measureCycles(F fn)
+{
+    ticks_t start = clock.counter();
+    for (uint16_t i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        fn(i);
+    }
+    ticks_t end = clock.counter();
+    return (uint32_t)((end - start) * CLOCK_PRESCALER / BENCH_ITERATIONS);
+}
+
+static uint32_t overhead = 0;
+
+static void report(PGM_P name, uint32_t cycles)
+{
+    debug.info_P(PSTR("%-28S %6lu cycles\n"), name, cycles > overhead ? cycles - overhead : 0);
+}
+
+void benchTime()
+{
+    // float based conversions the clock used before the integer timebase
+    report(PSTR("ticks->micros (float)"), measureCycles([](uint16_t i)
+                                                         { sinkFloat = (sourceTicks + i) / 2.0f; }));
+    report(PSTR("ticks->micros (int)"), measureCycles([](uint16_t i)
+                                                       { sinkInt = (uint16_t)Clock::toMicros(sourceTicks + i); }));
+
+    report(PSTR("time compare (float)"), measureCycles([](uint16_t i)
+                                                        { sinkBool = (sourceTicks + i) / 2.0f / 1000000.0f >= 0.4f; }));
+    report(PSTR("time compare (int)"), measureCycles([](uint16_t i)
+                                                      { sinkBool = Time::fromTicks(sourceTicks + i) >= Time::fromMillis(400); }));
+
+    report(PSTR("pid delta (float)"), measureCycles([](uint16_t i)
+                                                     { sinkFloat = (float)(i * 20) / 2.0f / 1000000.0f; }));
+    // the conversion FixedPIDController::calculate does on every update
+    report(PSTR("pid delta (fixed)"), measureCycles([](uint16_t i)
+                                                     { sinkFixed = toPIDSeconds(Time::fromTicks(i * 20).asTicks(), Q16_16()).raw; }));
+
+    Timer timer(&clock);
+    report(PSTR("timer elapsed (int)"), measureCycles([&](uint16_t i)
+                                                       { sinkBool = timer.elapsed(Time::fromMillis(i)); }));
+}
+
+void benchPID()
+{
+    static PIDController floatPID = {&clock, 0.5f, 8.0f, 0.0005f, 0.75f, 0.01f};
+    static FixedPIDController fixedPID = {&clock, Q16_16(0.5f), Q16_16(8.0f), Q16_16(0.0005f), Q16_16(0.75f), Q16_16(0.01f)};
+    const Time delta = Time::fromMillis(5);
+
+    // the single operations the controllers are built from
+    report(PSTR("add (float)"), measureCycles([](uint16_t i)
+                                               { sinkFloat = sourceFloat + sourceFloat; }));
+    report(PSTR("add (fixed)"), measureCycles([](uint16_t i)
+                                               { sinkInt = (Q16_16::fromRaw(sourceFixed) + Q16_16::fromRaw(sourceFixed)).raw; }));
+    report(PSTR("mul (float)"), measureCycles([](uint16_t i)
+                                               { sinkFloat = sourceFloat * sourceFloat; }));
+    report(PSTR("mul (fixed)"), measureCycles([](uint16_t i)
+                                               { sinkInt = (Q16_16::fromRaw(sourceFixed) * Q16_16::fromRaw(sourceFixed)).raw; }));
+    report(PSTR("div (float)"), measureCycles([](uint16_t i)
+                                               { sinkFloat = sourceFloat / sourceFloat; }));
+    report(PSTR("div (fixed)"), measureCycles([](uint16_t i)
+                                               { sinkInt = (Q16_16::fromRaw(sourceFixed) / Q16_16::fromRaw(sourceFixed)).raw; }));
+
+    floatPID.setTarget(1.0f);
+    fixedPID.setTarget(Q16_16(1.0f));
+    report(PSTR("pid calculate (float)"), measureCycles([&](uint16_t i)
+                                                         { sinkFloat = floatPID.calculate(0.25f, delta); }));
+    report(PSTR("pid calculate (fixed)"), measureCycles([&](uint16_t i)
+                                                         { sinkInt = fixedPID.calculate(Q16_16(0.25f), delta).raw; }));
+
+    // run both controllers through the same step changes and compare their outputs
+    static const float targets[] = {1.0f, -0.75f, 0.3f, 0.0f};
+    float floatOutput = 0.0f;
+    Q16_16 fixedOutput = Q16_16();
+    float maxError = 0.0f;
+    for (uint8_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++)
+    {
+        floatPID.setTarget(targets[t]);
+        fixedPID.setTarget(Q16_16(targets[t]));
+        for (uint8_t i = 0; i < 100; i++)
+        {
+            floatOutput = floatPID.calculate(floatOutput, delta);
+            fixedOutput = fixedPID.calculate(fixedOutput, delta);
+            float error = fabs(floatOutput - fixedOutput.toFloat());
+            if (error > maxError)
+                maxError = error;
+        }
+    }
+    debug.info_P(PSTR("pid max fixed/float difference: %lu ppm of full scale\n"), (unsigned long)(maxError * 1000000.0f));
+}
+
+// Counts main loop iterations per second while the drivetrain telemetry is read at 100 Hz
+// (needs the drivetrain board on the bus, failed reads are reported)
+#define BRAIN_LOOP_POLL_INTERVAL Time::fromMillis(10)
+#define BRAIN_LOOP_DURATION Time::fromMillis(1000)
+
+void benchBrainLoop()
+{
+    static TelemetryFrame frame;
+    Timer duration(&clock);
+    Timer poll(&clock);
+    uint32_t iterations;
+    uint16_t reads, failures;
+
+    TWI::enable();
+
+    // blocking master: the loop stops for every transfer
+    ByteStream i2c = TWI::getStream();
+    iterations = 0;
+    reads = 0;
+    failures = 0;
+    duration.restart();
+    poll.restart();
+    while (!duration.elapsed(BRAIN_LOOP_DURATION))
+    {
+        if (poll.elapsed(BRAIN_LOOP_POLL_INTERVAL))
+        {
+            poll.restart();
+            reads++;
+            if (!TWI::requestFrom(DRIVETRAIN_I2C) || i2c.read((uint8_t *)&frame, 0, sizeof(frame)) != sizeof(frame))
+                failures++;
+            TWI::endTransfer();
+        }
+        iterations++;
+    }
+    debug.info_P(PSTR("brain loop (blocking i2c): %lu loops/s, %u/%u reads failed\n"), iterations, failures, reads);
+
+    // queued transactions: the loop keeps running while the interrupt transfers
+    TWITransaction transaction;
+    iterations = 0;
+    reads = 0;
+    failures = 0;
+    duration.restart();
+    poll.restart();
+    while (!duration.elapsed(BRAIN_LOOP_DURATION))
+    {
+        if (poll.elapsed(BRAIN_LOOP_POLL_INTERVAL) && transaction.result != TWIResult::Pending)
+        {
+            poll.restart();
+            if (reads > 0 && transaction.result != TWIResult::Done)
+                failures++;
+            reads++;
+            TWI::requestFrom(DRIVETRAIN_I2C, (uint8_t *)&frame, sizeof(frame), &transaction);
+        }
+        TWI::poll();
+        iterations++;
+    }
+    if (TWI::wait(&transaction) != TWIResult::Done)
+        failures++;
+    debug.info_P(PSTR("brain loop (queued i2c): %lu loops/s, %u/%u reads failed\n"), iterations, failures, reads);
+
+    TWI::disable();
+}
+
+// Sends reliable packets between two links over an in-memory loopback for a while and reports the goodput.
+// The loopback delivers bytes at the radio baud rate on one shared, half duplex channel and drops whole frames.
+#define LINK_BENCH_BAUD 9600UL
+#define LINK_BENCH_BYTE_TIME Time::fromMicros(10 * 1000000UL / LINK_BENCH_BAUD)
+#define LINK_BENCH_DURATION Time::fromMillis(4000)
+#define LINK_BENCH_TYPE 0x10
+#define LINK_BENCH_STOP 0x11
+#define LINK_BENCH_STOP_INTERVAL Time::fromMillis(250)
+
+typedef struct Loopback
+{
+    RingBuffer<uint8_t, 256> bytes;
+    bool inFrame;
+    bool dropping;
+} Loopback;
+
+static Loopback toReceiver, toSender;
+static Time channelFree;
+static uint8_t lossPercent;
+
+template <Loopback *L>
+static int loopPut(uint8_t data, ByteStream *stream)
+{
+    if (!L->inFrame)
+    {
+        L->inFrame = true;
+        L->dropping = (uint8_t)(rand() % 100) < lossPercent;
+    }
+    if (data == PACKET_DELIMITER)
+        L->inFrame = false;
+
+    // a lost frame still takes its time on the channel
+    Time now = Clock::time();
+    channelFree = (channelFree > now ? channelFree : now) + LINK_BENCH_BYTE_TIME;
+    if (L->dropping)
+        return 0;
+    return L->bytes.push(data) ? 0 : -1;
+}
+
+template <Loopback *L>
+static int loopLen(ByteStream *stream)
+{
+    // the bytes still waiting for the channel have not arrived yet
+    Time now = Clock::time();
+    uint8_t sending = channelFree > now ? (channelFree - now).asTicks() / LINK_BENCH_BYTE_TIME.asTicks() : 0;
+    uint8_t count = L->bytes.count();
+    return count > sending ? count - sending : 0;
+}
+
+template <Loopback *L>
+static int loopGet(ByteStream *stream, bool last)
+{
+    uint8_t data;
+    return loopLen<L>(stream) > 0 && L->bytes.pop(&data) ? data : -1;
+}
+
+static void resetLoopback(uint8_t loss)
+{
+    toReceiver.bytes.clear();
+    toReceiver.inFrame = false;
+    toSender.bytes.clear();
+    toSender.inFrame = false;
+    channelFree = Clock::time();
+    lossPercent = loss;
+}
+
+void benchRadioLink()
+{
+    static const uint8_t lossRates[] = {0, 5, 10, 20};
+    static PacketLink senderLink, receiverLink;
+    uint8_t payload[PACKET_MAX_PAYLOAD] = {};
+    Timer duration(&clock);
+    srand(1);
+
+    // the sender either writes to the link directly or through a scheduler polled when the channel is free, as the brain does
+    for (uint8_t i = 0; i < 2 * sizeof(lossRates); i++)
+    {
+        uint8_t r = i % sizeof(lossRates);
+        bool scheduled = i >= sizeof(lossRates);
+        resetLoopback(lossRates[r]);
+        senderLink = PacketLink(ByteStream(loopPut<&toReceiver>, loopGet<&toSender>, loopLen<&toSender>));
+        receiverLink = PacketLink(ByteStream(loopPut<&toSender>, loopGet<&toReceiver>, loopLen<&toReceiver>));
+        PacketScheduler scheduler(&senderLink);
+        ReliableLink sender(&senderLink, scheduled ? &scheduler : nullptr);
+        ReliableLink receiver(&receiverLink);
+
+        uint8_t next = 0, expected = 0;
+        uint16_t outOfOrder = 0;
+        uint32_t bytes = 0;
+        duration.restart();
+        while (!duration.elapsed(LINK_BENCH_DURATION))
+        {
+            payload[0] = next;
+            if (sender.send(LINK_BENCH_TYPE, payload, sizeof(payload)))
+                next++;
+            sender.poll();
+            if (scheduled && channelFree <= Clock::time())
+                scheduler.poll();
+            receiver.poll();
+
+            const Packet *packet = receiver.receive();
+            if (packet != nullptr)
+            {
+                if (packet->payload[0] != expected)
+                    outOfOrder++;
+                expected = packet->payload[0] + 1;
+                bytes += packet->length;
+                receiver.release();
+            }
+        }
+
+        ReliableStats stats = sender.getStats();
+        debug.info_P(PSTR("reliable link%S %2u%% loss: %4lu B/s, %u retransmits, %u duplicates, %u out of order\n"),
+                     scheduled ? PSTR(" (scheduled)") : PSTR(""), lossRates[r], (unsigned long)(bytes * 1000UL / LINK_BENCH_DURATION.asMillis()),
+                     stats.retransmits, receiver.getStats().duplicates, outOfOrder);
+    }
+
+    // unreliable packets are sent whenever the channel is free, lost ones stay lost
+    for (uint8_t r = 0; r < sizeof(lossRates); r++)
+    {
+        resetLoopback(lossRates[r]);
+        senderLink = PacketLink(ByteStream(loopPut<&toReceiver>, loopGet<&toSender>, loopLen<&toSender>));
+        receiverLink = PacketLink(ByteStream(loopPut<&toSender>, loopGet<&toReceiver>, loopLen<&toReceiver>));
+        ReliableLink sender(&senderLink);
+        ReliableLink receiver(&receiverLink);
+
+        uint16_t sent = 0, received = 0;
+        uint32_t bytes = 0;
+        duration.restart();
+        while (!duration.elapsed(LINK_BENCH_DURATION))
+        {
+            if (channelFree <= Clock::time() && sender.sendUnreliable(LINK_BENCH_TYPE, payload, sizeof(payload)))
+                sent++;
+            receiver.poll();
+
+            const Packet *packet = receiver.receive();
+            if (packet != nullptr)
+            {
+                received++;
+                bytes += packet->length;
+                receiver.release();
+            }
+        }
+
+        debug.info_P(PSTR("unreliable link %2u%% loss: %4lu B/s, %u/%u packets received\n"),
+                     lossRates[r], (unsigned long)(bytes * 1000UL / LINK_BENCH_DURATION.asMillis()), received, sent);
+    }
+}
+
+// Keeps the bulk class full of telemetry and sends a stop command every LINK_BENCH_STOP_INTERVAL,
+// reports how long the stop takes to arrive when it is sent as bulk (plain FIFO) and as control
+void benchRadioPriority()
+{
+    static const PacketPriority stopPriorities[] = {PacketPriority::Bulk, PacketPriority::Control};
+    static PacketLink senderLink, receiverLink;
+    uint8_t payload[PACKET_MAX_PAYLOAD] = {};
+    Timer duration(&clock);
+    Timer stopTimer(&clock);
+
+    for (uint8_t r = 0; r < sizeof(stopPriorities) / sizeof(stopPriorities[0]); r++)
+    {
+        resetLoopback(0);
+        senderLink = PacketLink(ByteStream(loopPut<&toReceiver>, loopGet<&toSender>, loopLen<&toSender>));
+        receiverLink = PacketLink(ByteStream(loopPut<&toSender>, loopGet<&toReceiver>, loopLen<&toReceiver>));
+        PacketScheduler scheduler(&senderLink);
+
+        Time stopSent;
+        bool stopPending = false;
+        uint16_t stops = 0;
+        ticks_t maxLatency = 0, totalLatency = 0;
+        duration.restart();
+        stopTimer.restart();
+        while (!duration.elapsed(LINK_BENCH_DURATION))
+        {
+            // saturate the link with telemetry
+            while (scheduler.send(PacketPriority::Bulk, LINK_BENCH_TYPE, payload, sizeof(payload)))
+                ;
+            if (!stopPending && stopTimer.elapsed(LINK_BENCH_STOP_INTERVAL))
+            {
+                stopTimer.restart();
+                stopPending = scheduler.send(stopPriorities[r], LINK_BENCH_STOP, nullptr, 0);
+                stopSent = Clock::time();
+            }
+
+            // the radio sends one packet at a time
+            if (channelFree <= Clock::time())
+                scheduler.poll();
+
+            const Packet *packet = receiverLink.receive();
+            if (packet != nullptr)
+            {
+                if (packet->type == LINK_BENCH_STOP && stopPending)
+                {
+                    ticks_t latency = (Clock::time() - stopSent).asTicks();
+                    totalLatency += latency;
+                    if (latency > maxLatency)
+                        maxLatency = latency;
+                    stops++;
+                    stopPending = false;
+                }
+                receiverLink.release();
+            }
+        }
+
+        PacketClassStats bulk = scheduler.getStats(PacketPriority::Bulk);
+        debug.info_P(PSTR("stop as %S: %u stops, %lu ms max, %lu ms avg latency, bulk queue max %u packets, %u ms max wait\n"),
+                     r == 0 ? PSTR("bulk") : PSTR("control"), stops, (unsigned long)Clock::toMillis(maxLatency),
+                     (unsigned long)(stops > 0 ? Clock::toMillis(totalLatency / stops) : 0), bulk.maxDepth, bulk.maxLatency);
+    }
+}
+
+int main()
+{
+    debug = DebugInterface("Benchmark", CURRENT_VERSION);
+    debug.printHeader();
+
+    clock.init();
+
+    overhead = measureCycles([](uint16_t i) {});
+    debug.info_P(PSTR("loop overhead %lu cycles\n"), overhead);
+
+    benchTime();
+    benchPID();
+    benchBrainLoop();
+    benchRadioLink();
+    benchRadioPriority();
+
+    while (1)
+        ;
+}
\ No newline at end of file
@@ -6,15 +6,131 @@
 #include <clock.h>
 #include <timer.h>
 #include <radio.h>
+#include <packet.h>
+#include <reliablelink.h>
+#include <packetscheduler.h>
+#include <telemetrycodec.h>
+#include <scheduler.h>
 
 DebugInterface debug;
 
 Clock clock;
+Scheduler scheduler(&clock);
 Drivetrain drivetrain(&clock);
 IOPort io = io_port_default;
+PacketLink radioLink;
+PacketScheduler radioScheduler(&radioLink);
+ReliableLink radioReliable(&radioLink, &radioScheduler);
+Radio *radio = nullptr;
+bool radioOnline = false;
+TelemetryEncoder telemetryEncoder;
 
 #define LED_PIN 13
 
+#define DRIVETRAIN_POLL_INTERVAL Time::fromMillis(100)
+#define TELEMETRY_LOG_INTERVAL Time::fromMillis(2000)
+#define HEARTBEAT_INTERVAL Time::fromMillis(500)
+#define TELEMETRY_DOWNLINK_INTERVAL Time::fromMillis(100)
+
+void pollDrivetrain(void *context)
+{
+    drivetrain.requestUpdate();
+}
+
+void pollRadio()
+{
+    radioReliable.poll();
+    const Packet *packet = radioReliable.receive();
+    if (packet != nullptr)
+    {
+        if (packet->type == PACKET_TELEMETRY_ACK && packet->length == 1)
+            telemetryEncoder.acknowledge(packet->payload[0]);
+        else
+            DEBUG_INFO("Radio packet %u #%u (%u bytes)\n", packet->type, packet->sequence, packet->length);
+        radioReliable.release();
+    }
+    // sending blocks on the radio, one packet per pass keeps the main loop going
+    radioScheduler.poll();
+}
+
+void pollBus()
+{
+    drivetrain.poll();
+    // the setup commands own the radio until it is ready
+    if (radioOnline)
+        pollRadio();
+    else if (radio != nullptr)
+        radio->poll();
+}
+
+void logTelemetry(void *context)
+{
+    if (drivetrain.isOnline())
+        drivetrain.logTelemetry();
+    else
+        DEBUG_WARN("Drivetrain not responding\n");
+}
+
+static_assert(TELEMETRY_KEYFRAME_SIZE <= PACKET_MAX_PAYLOAD, "a telemetry keyframe must fit into a packet");
+
+void sendTelemetry(void *context)
+{
+    if (!radioOnline || !drivetrain.isOnline())
+        return;
+
+    CompactDrivetrainTelemetry compact;
+    TelemetryRecord record;
+    compact.pack(drivetrain.getTelemetry());
+    compact.toRecord(&record);
+
+    uint8_t buf[TELEMETRY_KEYFRAME_SIZE];
+    uint8_t length = telemetryEncoder.encode(record, buf);
+    radioReliable.sendUnreliable(PACKET_TELEMETRY, buf, length);
+}
+
+void heartbeat(void *context)
+{
+    io.put(LED_PIN, !io.get_port(LED_PIN));
+}
+
+void radioReady(void *context)
+{
+    DEBUG_INFO("Radio ready\n");
+
+    radio->flush();
+    radioOnline = true;
+
+    static const uint8_t hello[] = {0xAB, 0xCD, 0xEF, 0x13};
+    radioReliable.send(PACKET_HELLO, hello, sizeof(hello));
+}
+
+static RadioCommand radioSetup[4];
+
+void radioConfigured(RadioCommand *command)
+{
+    for (uint8_t i = 0; i < sizeof(radioSetup) / sizeof(radioSetup[0]); i++)
+    {
+        if (radioSetup[i].result != RadioResult::Done)
+            // not a DEBUG_WARN, the binary log can not send the name from program memory
+            debug.warn_P(PSTR("Radio setup command %u: %S\n"), i, Radio::nameOfResult(radioSetup[i].result));
+    }
+
+    DEBUG_INFO("Radio setup done\n");
+
+    radio->exitSetup();
+    scheduler.after(Time::fromMillis(800), radioReady);
+}
+
+void configureRadio(void *context)
+{
+    // the commands run from the idle hook, the main loop keeps going while the radio answers
+    radioSetup[3].callback = radioConfigured;
+    radio->setChannel(42, &radioSetup[0]);
+    radio->setBaud(9600L, &radioSetup[1]);
+    radio->setMode(RadioMode::Normal, &radioSetup[2]);
+    radio->setPower(RADIO_POWER_20, &radioSetup[3]);
+}
+
 int main()
 {
     io.reset();
@@ -26,40 +142,28 @@ int main()
     drivetrain.enable();
     sei();
 
-    Timer timer(&clock);
-    Radio radio = Radio(&io);
-
-    io.set_dir(LED_PIN, IODir::Out);
+    static const uint8_t busDevices[] = {DRIVETRAIN_I2C, ENVIRONMENT_I2C};
+    TWISpeed busSpeed = TWI::selfTest(busDevices, sizeof(busDevices), TWISpeed::FastPlus);
+    DEBUG_INFO("I2C bus running at %lu Hz\n", (uint32_t)busSpeed);
 
-    debug.info_P(PSTR("Setting up radio\n"));
-    radio.enterSetup();
-    radio.enable();
-    timer.spinWait(Time::fromSeconds(0.4f));
+    Radio radioDevice = Radio(&io);
+    radio = &radioDevice;
+    radioLink = PacketLink(radio->getStream());
 
-    radio.setChannel(42);
-    radio.setBaud(9600L);
-    radio.setMode(RadioMode::Normal);
-    radio.setPower(RADIO_POWER_20);
-
-    debug.info_P(PSTR("Radio setup done\n"));
-
-    radio.exitSetup();
-    timer.spinWait(Time::fromSeconds(0.8f));
+    io.set_dir(LED_PIN, IODir::Out);
 
-    debug.info_P(PSTR("Radio ready\n"));
+    DEBUG_INFO("Setting up radio\n");
+    radio->enterSetup();
+    radio->enable();
+    scheduler.after(Time::fromMillis(400), configureRadio);
 
-    radio.send(0xAB);
-    radio.send(0xCD);
-    radio.send(0xEF);
-    radio.send(0x13);
+    scheduler.every(DRIVETRAIN_POLL_INTERVAL, pollDrivetrain);
+    scheduler.every(TELEMETRY_LOG_INTERVAL, logTelemetry);
+    scheduler.every(HEARTBEAT_INTERVAL, heartbeat);
+    scheduler.every(TELEMETRY_DOWNLINK_INTERVAL, sendTelemetry);
+    scheduler.setIdleHook(pollBus);
 
     // drivetrain.drive(Direction::Forward);
 
-    // while (1)
-    // {
-    //     drivetrain.setVelocity(1, 1);
-    //     timer.spinWait(Time::fromSeconds(0.6f));
-    //     drivetrain.setVelocity(1, -1);
-    //     timer.spinWait(Time::fromSeconds(0.3f));
-    // }
+    scheduler.run();
 }
\ No newline at end of file
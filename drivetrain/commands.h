@@ -2,37 +2,15 @@
 #define DRIVETRAIN_COMMANDS_H
 
 #include <framework.h>
-
-typedef struct
-{
-    uint8_t direction;
-} DriveCommandData;
-
-typedef struct
-{
-    float angle;
-} TurnCommandData;
-
-typedef struct
-{
-    float leftVelocity;
-    float rightVelocity;
-} SetVelocityCommandData;
-
-typedef struct
-{
-    float velocity;
-} SetTurnVelocityCommandData;
-
-typedef struct
-{
-    float distance;
-} MoveCommandData;
+#include <clock.h>
+#include <messages.h>
 
 typedef struct
 {
     uint8_t id;
-    unsigned long startTime;
+    /// @brief Sequence number from a batch, 0 for commands sent on their own
+    uint8_t sequence;
+    ticks_t startTime;
 
     union
     {
@@ -41,6 +19,7 @@ typedef struct
         SetVelocityCommandData setVelocityData;
         SetTurnVelocityCommandData setTurnVelocityData;
         MoveCommandData moveData;
+        SetPIDGainCommandData setPIDGainData;
     };
 } Command;
 
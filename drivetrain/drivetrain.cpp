@@ -7,15 +7,20 @@
 #include <usart.h>
 #include <motor.h>
 #include <PWMMotor.h>
+#include <pwmengine.h>
 #include <pidcontroller.h>
 #include <status.h>
 #include <serialdebug.h>
 #include "commands.h"
 #include <serialize.h>
 #include <staticqueue.h>
+#include <objectpool.h>
+#include <timer.h>
+#include <controlloop.h>
+#include <telemetry.h>
 
 DebugInterface debug;
-ByteStream i2c;
+TWISlaveStream i2c;
 
 float targetLeftPower = 0.0f;
 float targetRightPower = 0.0f;
@@ -23,8 +28,31 @@ float leftVelocity = 1.0f;
 float rightVelocity = 1.0f;
 float turnVelocity = 1.0f;
 float currentAngle = 0.0f;
-
+volatile uint8_t runningCommandId = CMD_NONE;
+volatile bool compactTelemetry = false;
+// batched command progress reported in the telemetry, written by the main loop only
+volatile uint8_t acceptedSequence = 0;
+volatile uint8_t completedSequence = 0;
+volatile uint8_t rejectedSequence = 0;
+
+// Wheel speeds sampled by the control loop for the next telemetry publish
+typedef struct WheelSpeeds
+{
+    Q16_16 frontLeft;
+    Q16_16 frontRight;
+    Q16_16 centerLeft;
+    Q16_16 centerRight;
+    Q16_16 backLeft;
+    Q16_16 backRight;
+} WheelSpeeds;
+
+// written by the control loop, the main loop copies it with interrupts disabled
+WheelSpeeds sampledSpeeds;
+volatile bool speedsSampled = false;
+
+// the queue holds COMMAND_QUEUE_SIZE - 1 commands, the pool has room for one more that is running
 static StaticQueue<Command *> command_queue(COMMAND_QUEUE_SIZE);
+static ObjectPool<Command, COMMAND_QUEUE_SIZE> command_pool;
 
 Clock clock;
 
@@ -42,22 +70,24 @@ PWMMotor centerRightController = {50};
 PWMMotor backLeftController = {50};
 PWMMotor backRightController = {50};
 
-#define WHEEL_PID           \
-    {                       \
-        &clock, 8.0f, 0.01f \
+// Default wheel gains: most of a target step is fed forward, the integral settles the rest
+#define WHEEL_PID                                                                      \
+    {                                                                                  \
+        &clock, Q16_16(0.0f), Q16_16(8.0f), Q16_16(0.0f), Q16_16(0.75f), Q16_16(0.01f) \
     }
 
-PIDController frontLeftPID = WHEEL_PID;
-PIDController frontRightPID = WHEEL_PID;
-PIDController centerLeftPID = WHEEL_PID;
-PIDController centerRightPID = WHEEL_PID;
-PIDController backLeftPID = WHEEL_PID;
-PIDController backRightPID = WHEEL_PID;
+FixedPIDController frontLeftPID = WHEEL_PID;
+FixedPIDController frontRightPID = WHEEL_PID;
+FixedPIDController centerLeftPID = WHEEL_PID;
+FixedPIDController centerRightPID = WHEEL_PID;
+FixedPIDController backLeftPID = WHEEL_PID;
+FixedPIDController backRightPID = WHEEL_PID;
 
+// Converts the command targets for the wheel controllers, the control loop itself only uses fixed-point math
 void setPIDTargets()
 {
-    float leftSpeed = targetLeftPower * leftVelocity;
-    float rightSpeed = targetRightPower * rightVelocity;
+    Q16_16 leftSpeed = Q16_16(targetLeftPower * leftVelocity);
+    Q16_16 rightSpeed = Q16_16(targetRightPower * rightVelocity);
 
     frontLeftPID.setTarget(leftSpeed);
     centerLeftPID.setTarget(leftSpeed);
@@ -68,18 +98,54 @@ void setPIDTargets()
     backRightPID.setTarget(rightSpeed);
 }
 
+FixedPIDController *wheelPIDs[] = {
+    &frontLeftPID,
+    &frontRightPID,
+    &centerLeftPID,
+    &centerRightPID,
+    &backLeftPID,
+    &backRightPID};
+
+// Sets one gain of every wheel controller selected by the wheel mask
+void setPIDGain(uint8_t wheels, uint8_t gain, float value)
+{
+    Q16_16 fixedValue = Q16_16(value);
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        if (!(wheels & (1 << i)))
+            continue;
+
+        switch (gain)
+        {
+        case DRIVETRAIN_GAIN_P:
+            wheelPIDs[i]->setP(fixedValue);
+            break;
+        case DRIVETRAIN_GAIN_I:
+            wheelPIDs[i]->setI(fixedValue);
+            break;
+        case DRIVETRAIN_GAIN_D:
+            wheelPIDs[i]->setD(fixedValue);
+            break;
+        case DRIVETRAIN_GAIN_F:
+            wheelPIDs[i]->setF(fixedValue);
+            break;
+        }
+    }
+}
+
+// Called with the control loop blocked, targets are shared with the control loop tasks
 bool allWheelsAtTarget()
 {
-    return frontLeftPID.atTarget(frontLeftController.getSpeed()) &&
-           frontRightPID.atTarget(frontRightController.getSpeed()) &&
-           centerLeftPID.atTarget(centerLeftController.getSpeed()) &&
-           centerRightPID.atTarget(centerRightController.getSpeed()) &&
-           backLeftPID.atTarget(backLeftController.getSpeed()) &&
-           backRightPID.atTarget(backRightController.getSpeed());
+    return frontLeftPID.atTarget(frontLeftController.getSpeedFixed()) &&
+           frontRightPID.atTarget(frontRightController.getSpeedFixed()) &&
+           centerLeftPID.atTarget(centerLeftController.getSpeedFixed()) &&
+           centerRightPID.atTarget(centerRightController.getSpeedFixed()) &&
+           backLeftPID.atTarget(backLeftController.getSpeedFixed()) &&
+           backRightPID.atTarget(backRightController.getSpeedFixed());
 }
 
 // Processes a command and return true if it is complete, false if it needs to be called again
-bool processCommand(Command *cmd, unsigned long delta)
+bool processCommand(Command *cmd, ticks_t delta)
 {
     if (cmd == nullptr)
         return true;
@@ -128,209 +194,319 @@ bool processCommand(Command *cmd, unsigned long delta)
         // Placeholder without precise distance measurements
         return true;
     }
+    case CMD_DRIVETRAIN_SET_PID_GAIN:
+    {
+        setPIDGain(cmd->setPIDGainData.wheels, cmd->setPIDGainData.gain, cmd->setPIDGainData.value);
+        return true;
+    }
     }
 
     return true;
 }
 
-Status requestData()
+// Converts a wheel speed into the compact wire scale with integer math (rounds to nearest, saturates)
+static int16_t speedToWire(Q16_16 speed)
 {
-    uint8_t buf[4];
+    constexpr int32_t scale = (int32_t)WIRE_SPEED_SCALE;
+    // raw * scale >> 16 split into the integer and fraction parts, so nothing needs 64 bits
+    int32_t whole = (int32_t)(int16_t)(speed.raw >> 16) * scale;
+    uint32_t fraction = ((uint32_t)(uint16_t)speed.raw * scale + 0x8000) >> 16;
+    int32_t scaled = whole + (int32_t)fraction;
+    return scaled > INT16_MAX ? INT16_MAX : scaled < INT16_MIN ? INT16_MIN : (int16_t)scaled;
+}
 
-    // return the current motor speeds
-    encodeFloat(buf, frontLeftController.getSpeed());
-    if (i2c.write(buf, 0, 4) != 4)
-        return Status::INCOMPLETE_DATA;
-    encodeFloat(buf, frontRightController.getSpeed());
-    if (i2c.write(buf, 0, 4) != 4)
-        return Status::INCOMPLETE_DATA;
-    encodeFloat(buf, centerLeftController.getSpeed());
-    if (i2c.write(buf, 0, 4) != 4)
-        return Status::INCOMPLETE_DATA;
-    encodeFloat(buf, centerRightController.getSpeed());
-    if (i2c.write(buf, 0, 4) != 4)
-        return Status::INCOMPLETE_DATA;
-    encodeFloat(buf, backLeftController.getSpeed());
-    if (i2c.write(buf, 0, 4) != 4)
-        return Status::INCOMPLETE_DATA;
-    encodeFloat(buf, backRightController.getSpeed());
-    if (i2c.write(buf, 0, 4) != 4)
-        return Status::INCOMPLETE_DATA;
+// Copies the wheel speeds for publishTelemetry, runs in the control loop so it stays free of float math
+void sampleSpeeds()
+{
+    sampledSpeeds.frontLeft = frontLeftController.getSpeedFixed();
+    sampledSpeeds.frontRight = frontRightController.getSpeedFixed();
+    sampledSpeeds.centerLeft = centerLeftController.getSpeedFixed();
+    sampledSpeeds.centerRight = centerRightController.getSpeedFixed();
+    sampledSpeeds.backLeft = backLeftController.getSpeedFixed();
+    sampledSpeeds.backRight = backRightController.getSpeedFixed();
+    speedsSampled = true;
+}
 
-    // return the current command id
-    uint8_t id = -1;
-    if (i2c.write(&id, 0, 1) != 1)
-        return Status::INCOMPLETE_DATA;
+// Serializes the last sampled state into the telemetry frame the TWI interrupt serves to the brain
+void publishTelemetry()
+{
+    WheelSpeeds speeds;
+    uint8_t _SREG = SREG;
+    cli();
+    speeds = sampledSpeeds;
+    speedsSampled = false;
+    SREG = _SREG;
+
+    // a skipped publish is retried after the next sample
+    if (compactTelemetry)
+    {
+        CompactTelemetryFrame frame;
+        frame.payload.frontLeftSpeed = speedToWire(speeds.frontLeft);
+        frame.payload.frontRightSpeed = speedToWire(speeds.frontRight);
+        frame.payload.centerLeftSpeed = speedToWire(speeds.centerLeft);
+        frame.payload.centerRightSpeed = speedToWire(speeds.centerRight);
+        frame.payload.backLeftSpeed = speedToWire(speeds.backLeft);
+        frame.payload.backRightSpeed = speedToWire(speeds.backRight);
+        frame.payload.commandId = runningCommandId;
+        frame.payload.leftPower = toWire(targetLeftPower, WIRE_POWER_SCALE);
+        frame.payload.rightPower = toWire(targetRightPower, WIRE_POWER_SCALE);
+        frame.payload.angle = angleToWire(currentAngle);
+        frame.payload.acceptedSequence = acceptedSequence;
+        frame.payload.completedSequence = completedSequence;
+        frame.payload.rejectedSequence = rejectedSequence;
+        frame.seal();
+        TWI::publish((uint8_t *)&frame, sizeof(frame));
+    }
+    else
+    {
+        TelemetryFrame frame;
+        frame.payload.frontLeftSpeed = speeds.frontLeft.toFloat();
+        frame.payload.frontRightSpeed = speeds.frontRight.toFloat();
+        frame.payload.centerLeftSpeed = speeds.centerLeft.toFloat();
+        frame.payload.centerRightSpeed = speeds.centerRight.toFloat();
+        frame.payload.backLeftSpeed = speeds.backLeft.toFloat();
+        frame.payload.backRightSpeed = speeds.backRight.toFloat();
+        frame.payload.commandId = runningCommandId;
+        frame.payload.leftPower = targetLeftPower;
+        frame.payload.rightPower = targetRightPower;
+        frame.payload.angle = currentAngle;
+        frame.payload.acceptedSequence = acceptedSequence;
+        frame.payload.completedSequence = completedSequence;
+        frame.payload.rejectedSequence = rejectedSequence;
+        frame.seal();
+        TWI::publish((uint8_t *)&frame, sizeof(frame));
+    }
+}
 
-    // return the left and right drivetrain power
-    encodeFloat(buf, targetLeftPower);
-    if (i2c.write(buf, 0, 4) != 4)
-        return Status::INCOMPLETE_DATA;
-    encodeFloat(buf, targetRightPower);
-    if (i2c.write(buf, 0, 4) != 4)
-        return Status::INCOMPLETE_DATA;
+// Decoders of the queued commands, indexed by id - 1. Kept in flash, read it with memcpy_P
+static constexpr MessageEntry<Command> commandTable[] PROGMEM = {
+    messageEntry<Command, DriveMessage, &Command::driveData>(),
+    messageEntry<Command, StopMessage>(),
+    messageEntry<Command, TurnMessage, &Command::turnData>(),
+    messageEntry<Command, SetVelocityMessage, &Command::setVelocityData>(),
+    messageEntry<Command, SetTurnVelocityMessage, &Command::setTurnVelocityData>(),
+    messageEntry<Command, MoveMessage, &Command::moveData>(),
+    messageEntry<Command, SetPIDGainMessage, &Command::setPIDGainData>()};
+
+#define COMMAND_TABLE_SIZE (sizeof(commandTable) / sizeof(commandTable[0]))
+static_assert(isIndexedById(commandTable, COMMAND_TABLE_SIZE), "commandTable must list the commands in id order starting at 1");
+
+// Reads the data of a queued command into command, the id may have the compact bit set
+Status readCommand(int id, Command *command)
+{
+    bool compact = id & CMD_COMPACT;
+    id &= ~CMD_COMPACT;
+    if (id < 1 || id > (int)COMMAND_TABLE_SIZE)
+        return Status::UNKOWN_ID;
 
-    // return the current angle
-    encodeFloat(buf, currentAngle);
-    if (i2c.write(buf, 0, 4) != 4)
+    MessageEntry<Command> entry;
+    memcpy_P(&entry, &commandTable[id - 1], sizeof(entry));
+    uint8_t size = compact ? entry.compactSize : entry.size;
+    uint8_t buf[DRIVETRAIN_MAX_COMMAND_SIZE];
+    if (i2c.read(buf, 0, size) != size)
         return Status::INCOMPLETE_DATA;
 
+    memset(command, 0, sizeof(Command));
+    command->id = (uint8_t)id;
+    command->startTime = clock.counter();
+    entry.decode(buf, compact, command);
     return Status::OK;
 }
 
-Status receiveData()
+// Copies the command into the pool and queues it, returns false if either is full
+bool enqueueCommand(const Command &command)
 {
-    Command *command = (Command *)malloc(sizeof(Command));
-    memset(command, 0, sizeof(Command));
+    Command *queued = command_pool.acquire();
+    if (queued == nullptr)
+        return false;
 
-    int id = i2c.read();
-
-    switch (id)
-    {
-    case CMD_DRIVETRAIN_DRIVE:
-    {
-        int direction = i2c.read();
-        command->id = CMD_DRIVETRAIN_DRIVE;
-        command->startTime = clock.counter();
-        command->driveData.direction = (uint8_t)direction;
-        break;
-    }
-    case CMD_DRIVETRAIN_STOP:
-    {
-        command->id = CMD_DRIVETRAIN_STOP;
-        command->startTime = clock.counter();
-        break;
-    }
-    case CMD_DRIVETRAIN_TURN:
-    {
-        uint8_t buf[4];
-        if (i2c.read(buf, 0, 4) == 4)
-        {
-            float angle = decodeFloat(buf);
-            command->id = CMD_DRIVETRAIN_TURN;
-            command->startTime = clock.counter();
-            command->turnData = {};
-            command->turnData.angle = angle;
-        }
-        break;
-    }
-    case CMD_DRIVETRAIN_SET_VELOCITY:
+    *queued = command;
+    if (!command_queue.Enqueue(queued))
     {
-        uint8_t buf[8];
-        if (i2c.read(buf, 0, 8) == 8)
-        {
-            float leftVelocity = decodeFloat(buf);
-            float rightVelocity = decodeFloat(buf + 4);
-            command->id = CMD_DRIVETRAIN_SET_VELOCITY;
-            command->startTime = clock.counter();
-            command->setVelocityData = {};
-            command->setVelocityData.leftVelocity = leftVelocity;
-            command->setVelocityData.rightVelocity = rightVelocity;
-        }
-        break;
+        command_pool.release(queued);
+        return false;
     }
-    case CMD_DRIVETRAIN_SET_TURN_VELOCITY:
+    return true;
+}
+
+// Reads a batch of sequenced commands. Once a command is rejected the rest of the batch is rejected as well,
+// so the brain can resend everything after the last accepted sequence in order.
+Status receiveBatch()
+{
+    int count = i2c.read();
+    if (count < 0)
+        return Status::INCOMPLETE_DATA;
+
+    Status result = Status::OK;
+    for (int i = 0; i < count; i++)
     {
-        uint8_t buf[4];
-        if (i2c.read(buf, 0, 4) == 4)
+        int sequence = i2c.read();
+        int id = i2c.read();
+        if (sequence < 0 || id < 0)
+            return Status::INCOMPLETE_DATA;
+
+        Command command;
+        Status status = readCommand(id, &command);
+        command.sequence = (uint8_t)sequence;
+        if (status == Status::OK && result == Status::OK && enqueueCommand(command))
         {
-            float velocity = decodeFloat(buf);
-            command->id = CMD_DRIVETRAIN_SET_TURN_VELOCITY;
-            command->startTime = clock.counter();
-            command->setTurnVelocityData = {};
-            command->setTurnVelocityData.velocity = velocity;
+            acceptedSequence = (uint8_t)sequence;
+            continue;
         }
-        break;
+
+        rejectedSequence = (uint8_t)sequence;
+        if (result == Status::OK)
+            result = status == Status::OK ? Status::CORRUPTED : status;
+        // the end of a command that failed to parse is unknown, the rest of the message is dropped
+        if (status != Status::OK)
+            break;
     }
-    case CMD_DRIVETRAIN_MOVE:
+
+    return result;
+}
+
+// Reads one message written by the brain
+Status receiveData()
+{
+    int id = i2c.read();
+    if (id < 0)
+        return Status::INCOMPLETE_DATA;
+
+    switch (id)
     {
-        uint8_t buf[4];
-        if (i2c.read(buf, 0, 4) == 4)
-        {
-            float distance = decodeFloat(buf);
-            command->id = CMD_DRIVETRAIN_MOVE;
-            command->startTime = clock.counter();
-            command->moveData = {};
-            command->moveData.distance = distance;
-        }
-        break;
-    }
-    default:
+    case CMD_DRIVETRAIN_SET_ENCODING:
     {
-        free(command);
-        return Status::UNKOWN_ID;
+        // handled right away, the brain switches once it sees the new telemetry version
+        uint8_t buf[SetEncodingMessage::maxSize()];
+        SetEncodingCommandData data;
+        if (i2c.read(buf, 0, SetEncodingMessage::size(false)) != SetEncodingMessage::size(false))
+            return Status::INCOMPLETE_DATA;
+        SetEncodingMessage::decode(buf, false, &data);
+        compactTelemetry = data.encoding == DRIVETRAIN_ENCODING_COMPACT;
+        return Status::OK;
     }
+    case CMD_DRIVETRAIN_BATCH:
+        return receiveBatch();
     }
 
-    bool ok = command_queue.Enqueue(command);
-    if (!ok)
-    {
-        free(command);
+    // a single command without a sequence number
+    Command command;
+    Status status = readCommand(id, &command);
+    if (status != Status::OK)
+        return status;
+
+    if (!enqueueCommand(command))
         return Status::CORRUPTED;
-    }
 
     return Status::OK;
 }
 
+// Slow control loop task, updates the motor speeds from the PID controllers and samples them for the telemetry
+void updatePIDs()
+{
+    frontLeftController.set(frontLeftPID.calculate(frontLeftController.getSpeedFixed()));
+    frontRightController.set(frontRightPID.calculate(frontRightController.getSpeedFixed()));
+    centerLeftController.set(centerLeftPID.calculate(centerLeftController.getSpeedFixed()));
+    centerRightController.set(centerRightPID.calculate(centerRightController.getSpeedFixed()));
+    backLeftController.set(backLeftPID.calculate(backLeftController.getSpeedFixed()));
+    backRightController.set(backRightPID.calculate(backRightController.getSpeedFixed()));
+
+    sampleSpeeds();
+}
+
+void logControlLoopStats()
+{
+    ControlLoopStats stats = ControlLoop::getStats();
+    DEBUG_INFO("loop: %lu ticks, %u overruns, latency %u/%uus, jitter %uus, runtime %u/%uus of %uus\n",
+               stats.ticks, stats.overruns,
+               stats.lastLatency, stats.maxLatency, stats.jitter,
+               stats.lastRuntime, stats.maxRuntime, stats.period);
+
+    USARTStats usartStats = USART::getStats();
+    DEBUG_INFO("usart: %u dropped, high water %u/%u, %u receive overflows\n",
+               usartStats.droppedBytes, usartStats.highWaterMark, USART_TX_BUFFER_SIZE - 1, usartStats.receiveOverflows);
+    ObjectPoolStats poolStats = command_pool.getStats();
+    DEBUG_INFO("commands: %u/%u used, high water %u, %u failed\n",
+               poolStats.used, command_pool.capacity(), poolStats.highWaterMark, poolStats.failures);
+    DEBUG_INFO("i2c: %u dropped, sequence %u accepted, %u completed, %u rejected\n",
+               TWI::getDroppedBytes(), acceptedSequence, completedSequence, rejectedSequence);
+}
+
 int main()
 {
     debug = DebugInterface("Drivetrain", CURRENT_VERSION);
     debug.printHeader();
+    // never hold up command processing for log output
+    USART::setOverflowPolicy(USARTOverflowPolicy::Drop);
 
     clock.init();
     TWI::enable(DRIVETRAIN_I2C);
-    i2c = TWI::getStream();
 
-    unsigned long prevCommandExec = 0;
+    frontLeftController.attach(frontLeftMotor);
+    frontRightController.attach(frontRightMotor);
+    centerLeftController.attach(centerLeftMotor);
+    centerRightController.attach(centerRightMotor);
+    backLeftController.attach(backLeftMotor);
+    backRightController.attach(backRightMotor);
+    if (!PWMEngine::enable())
+    {
+        DEBUG_ERROR("PWM engine frequency not supported\n");
+    }
+
+    ControlLoop::setSlowTask(updatePIDs);
+    if (!ControlLoop::enable())
+    {
+        DEBUG_ERROR("Control loop frequency not supported\n");
+    }
+
+    Timer statsTimer(&clock);
+    Time statsInterval = Time::fromMillis(5000);
+
+    ticks_t prevCommandExec = 0;
 
     Command *currentCommand = nullptr;
 
+    // The PWM engine and control loop drive the motors at a fixed rate,
+    // command processing and communication get the remaining time.
     while (1)
     {
-        unsigned long time = clock.counter();
-        // Execute current command
-        if (processCommand(currentCommand, time - prevCommandExec))
+        ticks_t time = clock.counter();
+
+        // Execute current command, blocking the control loop while targets are updated
+        uint8_t _SREG = SREG;
+        cli();
+        bool complete = processCommand(currentCommand, time - prevCommandExec);
+        SREG = _SREG;
+
+        if (complete)
         {
-            free(currentCommand);
+            if (currentCommand != nullptr && currentCommand->sequence != 0)
+                completedSequence = currentCommand->sequence;
+            command_pool.release(currentCommand);
             currentCommand = command_queue.Dequeue();
+            runningCommandId = currentCommand != nullptr ? currentCommand->id : CMD_NONE;
         }
         prevCommandExec = time;
 
-        if (TWI::isDataRequested())
-        {
-            Status status = requestData();
-            if (status != Status::OK)
-            {
-                debug.error("requestData returned '%s'\n", nameOfStatus(status));
-            }
-        }
-        else if (i2c.length() > 0)
+        if (speedsSampled)
+            publishTelemetry();
+
+        // telemetry reads are served by the TWI interrupt from the last published snapshot,
+        // writes are handled once the brain ended the message
+        if (TWI::messageLength() > 0)
         {
             Status status = receiveData();
+            TWI::endMessage();
             if (status != Status::OK)
             {
-                debug.error("receiveData returned '%s'\n", nameOfStatus(status));
+                DEBUG_ERROR("receiveData returned '%s'\n", nameOfStatus(status));
             }
         }
 
-        _delay_us(1);
-
-        setPIDTargets();
-
-        frontLeftController.set(frontLeftPID.calculate(frontLeftController.getSpeed()));
-        frontRightController.set(frontRightPID.calculate(frontRightController.getSpeed()));
-        centerLeftController.set(centerLeftPID.calculate(centerLeftController.getSpeed()));
-        centerRightController.set(centerRightPID.calculate(centerRightController.getSpeed()));
-        backLeftController.set(backLeftPID.calculate(backLeftController.getSpeed()));
-        backRightController.set(backRightPID.calculate(backRightController.getSpeed()));
-
-        float timestamp = clock.seconds();
-
-        frontLeftController.update(frontLeftMotor, timestamp);
-        frontRightController.update(frontRightMotor, timestamp);
-        centerLeftController.update(centerLeftMotor, timestamp);
-        centerRightController.update(centerRightMotor, timestamp);
-        backLeftController.update(backLeftMotor, timestamp);
-        backRightController.update(backRightMotor, timestamp);
+        if (statsTimer.elapsed(statsInterval))
+        {
+            statsTimer.restart();
+            logControlLoopStats();
+        }
     }
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <i2c.h>
 #include <serialdebug.h>
 #include <timer.h>
+#include <scheduler.h>
 
 DebugInterface debug;
 
@@ -13,6 +14,12 @@ IOPort io = io_port_default;
 #define LED_PIN 13
 
 Clock clock;
+Scheduler scheduler(&clock);
+
+void blink(void *context)
+{
+    io.put(LED_PIN, !io.get_port(LED_PIN));
+}
 
 int main()
 {
@@ -30,13 +37,6 @@ int main()
     io.reset();
     io.set_dir(LED_PIN, IODir::Out);
 
-    Timer timer(&clock);
-
-    while (1)
-    {
-        timer.spinWait(Time::fromSeconds(0.03f));
-        io.put(LED_PIN, true);
-        timer.spinWait(Time::fromSeconds(0.03f));
-        io.put(LED_PIN, false);
-    }
+    scheduler.every(Time::fromMillis(30), blink);
+    scheduler.run();
 }
\ No newline at end of file
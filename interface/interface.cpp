@@ -5,6 +5,8 @@
 #include <clock.h>
 #include <timer.h>
 #include <radio.h>
+#include <packet.h>
+#include <reliablelink.h>
 
 DebugInterface debug;
 
@@ -25,28 +27,36 @@ int main()
 
     Timer timer(&clock);
     Radio radio = Radio(&io);
+    PacketLink radioLink = PacketLink(radio.getStream());
+    ReliableLink radioReliable(&radioLink);
 
     io.set_dir(LED_PIN, IODir::Out);
 
-    debug.info_P(PSTR("Setting up radio\n"));
+    DEBUG_INFO("Setting up radio\n");
     radio.enterSetup();
     radio.enable();
-    timer.spinWait(Time::fromSeconds(0.4f));
+    timer.spinWait(Time::fromMillis(400));
 
     radio.setChannel(42);
     radio.setBaud(9600L);
     radio.setMode(RadioMode::Normal);
     radio.setPower(RADIO_POWER_20);
 
-    debug.info_P(PSTR("Radio setup done\n"));
+    DEBUG_INFO("Radio setup done\n");
 
     radio.exitSetup();
-    timer.spinWait(Time::fromSeconds(0.8f));
+    timer.spinWait(Time::fromMillis(800));
 
-    debug.info_P(PSTR("Radio ready\n"));
+    DEBUG_INFO("Radio ready\n");
 
-    radio.send(0xAB);
-    radio.send(0xCD);
-    radio.send(0xEF);
-    radio.send(0x13);
+    radio.flush();
+    static const uint8_t hello[] = {0xAB, 0xCD, 0xEF, 0x13};
+    radioReliable.send(PACKET_HELLO, hello, sizeof(hello));
+
+    while (1)
+    {
+        radioReliable.poll();
+        if (radioReliable.receive() != nullptr)
+            radioReliable.release();
+    }
 }
\ No newline at end of file
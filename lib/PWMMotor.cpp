@@ -1,38 +1,42 @@
 #include "framework.h"
 #include "PWMMotor.h"
+#include "pwmengine.h"
 
 PWMMotor::PWMMotor(float cycleFrequency)
 {
-    speed = 0.0f;
+    speed = Q16_16();
     pwmDuty = 0;
-    cycleTime = 1.0f / cycleFrequency;
+    channel = -1;
+    this->cycleFrequency = cycleFrequency;
+}
+
+bool PWMMotor::attach(Motor &motor)
+{
+    channel = PWMEngine::attach(motor.getPin1(), motor.getPin2(), cycleFrequency);
+    PWMEngine::setDuty(channel, pwmDuty, speed > Q16_16());
+    return channel >= 0;
 }
 
 void PWMMotor::set(float speed)
+{
+    set(Q16_16(speed));
+}
+
+void PWMMotor::set(Q16_16 speed)
 {
     this->speed = speed;
-    this->pwmDuty = (uint16_t)floor(fmin(1.0f, fabs(speed)) * (float)UINT16_MAX);
+    // 1.0 is 65536 in Q16.16, saturate to the full duty
+    int32_t magnitude = fabs(speed).raw;
+    this->pwmDuty = magnitude > UINT16_MAX ? UINT16_MAX : (uint16_t)magnitude;
+    PWMEngine::setDuty(channel, pwmDuty, speed > Q16_16());
 }
 
 float PWMMotor::getSpeed()
 {
-    return this->speed;
+    return this->speed.toFloat();
 }
 
-void PWMMotor::update(Motor motor, float timestamp)
+Q16_16 PWMMotor::getSpeedFixed()
 {
-    float cycleCount = timestamp / cycleTime;
-    float cycleDelta = cycleCount - floor(cycleCount);
-    uint16_t cycleDeltaInt = floor(cycleDelta * UINT16_MAX);
-    if (cycleDeltaInt < this->pwmDuty)
-    {
-        if (this->speed > 0)
-            motor.clockwise();
-        else
-            motor.counterclockwise();
-    }
-    else
-    {
-        motor.stop();
-    }
+    return this->speed;
 }
\ No newline at end of file
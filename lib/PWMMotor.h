@@ -3,6 +3,7 @@
 
 #include "framework.h"
 #include "motor.h"
+#include "fixed.h"
 
 typedef struct PWMMotor
 {
@@ -11,21 +12,28 @@ public:
     /// @param cycleFrequency The frequency in Hz of the PWM cycle
     PWMMotor(float cycleFrequency);
 
+    /// @brief Drives a motor from the PWM engine (call PWMEngine::enable() to start the output)
+    /// @param motor The target motor to spin
+    /// @return Returns false if the PWM engine has no channel left
+    bool attach(Motor &motor);
+
     /// @brief Sets the speed of the motor
     void set(float speed);
 
+    /// @brief Sets the speed of the motor without float math
+    void set(Q16_16 speed);
+
     /// @brief Returns the current speed of the motor
     float getSpeed();
 
-    /// @brief Spins a motor depending on the target PWM speed
-    /// @param motor The target motor to spin
-    /// @param timestamp The current absolute timestamp in seconds
-    void update(Motor motor, float timestamp);
+    /// @brief Returns the current speed of the motor without float math
+    Q16_16 getSpeedFixed();
 
 private:
-    float cycleTime;
-    float speed;
+    float cycleFrequency;
+    Q16_16 speed;
     uint16_t pwmDuty;
+    int8_t channel;
 } PWMMotor;
 
 #endif
\ No newline at end of file
@@ -6,4 +6,14 @@ ByteStream::ByteStream(int (*put)(uint8_t, ByteStream *), int (*get)(ByteStream
     this->put = put;
     this->get = get;
     this->len = len;
+    this->writeBlock = nullptr;
+    this->readBlock = nullptr;
+}
+
+ByteStream::ByteStream(int (*put)(uint8_t, ByteStream *), int (*get)(ByteStream *, bool), int (*len)(ByteStream *),
+                       int (*writeBlock)(const uint8_t *, int, ByteStream *), int (*readBlock)(ByteStream *, uint8_t *, int, bool))
+    : ByteStream(put, get, len)
+{
+    this->writeBlock = writeBlock;
+    this->readBlock = readBlock;
 }
\ No newline at end of file
@@ -8,11 +8,19 @@ typedef struct ByteStream
 {
 public:
     ByteStream(int (*put)(uint8_t, ByteStream *), int (*get)(ByteStream *, bool), int (*len)(ByteStream *));
+    /// @brief Creates a stream with block transfer functions, which replace the per byte calls for buffers
+    /// @param writeBlock Writes count bytes and returns the number written (nullptr to use put for every byte)
+    /// @param readBlock Reads up to count bytes and returns the number read, last ends the transfer (nullptr to use get for every byte)
+    ByteStream(int (*put)(uint8_t, ByteStream *), int (*get)(ByteStream *, bool), int (*len)(ByteStream *),
+               int (*writeBlock)(const uint8_t *, int, ByteStream *), int (*readBlock)(ByteStream *, uint8_t *, int, bool));
+    /// @brief Creates a closed stream, every operation fails until a stream is assigned
     ByteStream()
     {
-        put = (int (*)(uint8_t, ByteStream *))0x1337;
-        get = (int (*)(ByteStream *, bool))0x6969;
-        len = (int (*)(ByteStream *))0x4242;
+        put = closedPut;
+        get = closedGet;
+        len = closedLen;
+        writeBlock = nullptr;
+        readBlock = nullptr;
         pos = -1;
     }
 
@@ -39,6 +47,13 @@ public:
 
     inline int read(uint8_t *buf, int offset, int count, bool leaveOpen)
     {
+        if (readBlock != nullptr)
+        {
+            int c = count > 0 ? readBlock(this, buf + offset, count, !leaveOpen) : 0;
+            pos += c;
+            return c;
+        }
+
         int c = 0, d;
         for (int i = 0; i < count; i++)
         {
@@ -65,6 +80,13 @@ public:
 
     inline int write(uint8_t *data, int offset, int count)
     {
+        if (writeBlock != nullptr)
+        {
+            int c = count > 0 ? writeBlock(data + offset, count, this) : 0;
+            pos += c;
+            return c;
+        }
+
         int c = 0, d;
         for (int i = 0; i < count; i++)
         {
@@ -83,10 +105,17 @@ public:
     }
 
 private:
+    static int closedPut(uint8_t, ByteStream *) { return -1; }
+    static int closedGet(ByteStream *, bool) { return -1; }
+    static int closedLen(ByteStream *) { return -1; }
+
     int pos;                           /* bytes read or written so far */
     int (*put)(uint8_t, ByteStream *); /* function to write one byte to stream */
     int (*get)(ByteStream *, bool);    /* function to read one byte from stream */
     int (*len)(ByteStream *);          /* function to get length of stream */
+
+    int (*writeBlock)(const uint8_t *, int, ByteStream *); /* optional function to write a buffer to stream */
+    int (*readBlock)(ByteStream *, uint8_t *, int, bool);  /* optional function to read a buffer from stream */
 } ByteStream;
 
 #endif
\ No newline at end of file
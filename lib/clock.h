@@ -1,65 +1,174 @@
 #ifndef CLOCK_H
 #define CLOCK_H
 
-enum class TimePrecision
-{
-    Seconds = 0,
-    Micros = 1,
-    Ticks = 2
-};
+#include "framework.h"
+
+/// @brief Prescaler of the clock timer (Timer1)
+#define CLOCK_PRESCALER 8
+/// @brief Number of clock ticks per second
+#define CLOCK_TICKS_PER_SECOND (F_CPU / CLOCK_PRESCALER)
+/// @brief Number of clock ticks per microsecond
+#define CLOCK_TICKS_PER_MICRO (CLOCK_TICKS_PER_SECOND / 1000000UL)
+
+static_assert(CLOCK_TICKS_PER_SECOND % 1000000UL == 0, "Clock requires a whole number of ticks per microsecond");
 
+/// @brief Ticks per clock stamp as a power of two, the one closest to a millisecond (1.024 ms)
+#define CLOCK_STAMP_SHIFT (CLOCK_TICKS_PER_MICRO >= 2 ? 11 : 10)
+
+/// @brief Monotonic tick count of the clock (48 bits used, wraps after ~4.4 years at 2 MHz)
+typedef uint64_t ticks_t;
+
+/// @brief A timestamp or duration stored as an integer tick count
 typedef struct Time
 {
 public:
-    static Time fromTicks(unsigned long ticks);
-    static Time fromMicros(float micros);
-    static Time fromSeconds(float seconds);
+    constexpr Time() : count(0) {}
+
+    static constexpr Time fromTicks(ticks_t ticks)
+    {
+        return Time(ticks);
+    }
+
+    static constexpr Time fromMicros(uint32_t micros)
+    {
+        return Time((ticks_t)micros * CLOCK_TICKS_PER_MICRO);
+    }
+
+    static constexpr Time fromMillis(uint32_t millis)
+    {
+        return Time((ticks_t)millis * CLOCK_TICKS_PER_MICRO * 1000UL);
+    }
+
+    /// @note Only use with constants, the conversion is then done at compile time
+    static constexpr Time fromSeconds(float seconds)
+    {
+        return Time((ticks_t)(seconds * (float)CLOCK_TICKS_PER_SECOND + 0.5f));
+    }
+
     /// @brief Returns the absolute time between two absolute timestamps
-    static Time between(Time &a, Time &b);
+    static constexpr Time between(const Time &a, const Time &b)
+    {
+        return Time(a.count > b.count ? a.count - b.count : b.count - a.count);
+    }
 
-    TimePrecision getPrecision();
-    unsigned long asTicks();
-    float asMicros();
-    float asSeconds();
-    int compareTo(Time &other);
+    constexpr ticks_t asTicks() const
+    {
+        return count;
+    }
 
-private:
-    union
+    constexpr ticks_t asMicros() const
     {
-        unsigned long count;
-        float micros;
-        float seconds;
-    };
-    TimePrecision precision;
+        return count / CLOCK_TICKS_PER_MICRO;
+    }
+
+    constexpr ticks_t asMillis() const
+    {
+        return count / (CLOCK_TICKS_PER_MICRO * 1000UL);
+    }
+
+    /// @note Uses float math, keep out of hot paths
+    constexpr float asSeconds() const
+    {
+        return (float)count * (1.0f / (float)CLOCK_TICKS_PER_SECOND);
+    }
+
+    constexpr int compareTo(const Time &other) const
+    {
+        return count == other.count  ? 0
+               : count < other.count ? -1
+                                     : 1;
+    }
+
+    constexpr bool operator<(const Time &other) const { return count < other.count; }
+    constexpr bool operator<=(const Time &other) const { return count <= other.count; }
+    constexpr bool operator>(const Time &other) const { return count > other.count; }
+    constexpr bool operator>=(const Time &other) const { return count >= other.count; }
+    constexpr bool operator==(const Time &other) const { return count == other.count; }
+    constexpr bool operator!=(const Time &other) const { return count != other.count; }
+    constexpr Time operator+(const Time &other) const { return Time(count + other.count); }
+    constexpr Time operator-(const Time &other) const { return Time(count - other.count); }
+
+private:
+    constexpr explicit Time(ticks_t count) : count(count) {}
+
+    ticks_t count;
 } Time;
 
 /// @brief Clock provides basic timestamps based on a timer. It is best to only have one Clock object and pass it as a reference to functions that need it.
-typedef struct
+typedef struct Clock
 {
     /// @brief Initialize the clock timer (only call once in program)
-    void init();
+    static void init();
 
     /// @brief Returns the raw tick value of the counter
-    unsigned long counter();
-    Time time();
+    /// @note Safe to call from interrupts
+    static ticks_t counter();
+    static Time time();
 
     /// @brief Returns the current time in microseconds
-    float micros();
+    static ticks_t micros();
+
+    /// @brief Returns the current time in milliseconds
+    /// @note Divides 64 bits, use stamp() for frequent timestamps
+    static ticks_t millis();
+
+    /// @brief Returns the low 16 bits of the time in stamps of 2^CLOCK_STAMP_SHIFT ticks (about a millisecond).
+    /// Only shifts, so it is cheap enough for idle loops. The difference of two stamps wraps after about a minute.
+    static uint16_t stamp();
+
+    /// @brief Returns the current time in seconds
+    /// @note Uses float math, keep out of hot paths
+    static float seconds();
 
     /// @brief Converts a tick count into microseconds (for use with delta times)
-    static float toMicros(unsigned long count);
+    static constexpr ticks_t toMicros(ticks_t count)
+    {
+        return count / CLOCK_TICKS_PER_MICRO;
+    }
 
     /// @brief Converts microseconds info a tick count (for use with delta times)
-    static unsigned long fromMicros(float micros);
+    static constexpr ticks_t fromMicros(ticks_t micros)
+    {
+        return micros * CLOCK_TICKS_PER_MICRO;
+    }
 
-    /// @brief Returns the current time in seconds
-    float seconds();
+    /// @brief Converts a tick count into milliseconds (for use with delta times)
+    static constexpr ticks_t toMillis(ticks_t count)
+    {
+        return count / (CLOCK_TICKS_PER_MICRO * 1000UL);
+    }
+
+    /// @brief Converts milliseconds info a tick count (for use with delta times)
+    static constexpr ticks_t fromMillis(ticks_t millis)
+    {
+        return millis * CLOCK_TICKS_PER_MICRO * 1000UL;
+    }
+
+    /// @brief Converts a tick count into clock stamps (for use with delta times)
+    static constexpr ticks_t toStamps(ticks_t count)
+    {
+        return count >> CLOCK_STAMP_SHIFT;
+    }
+
+    /// @brief Converts clock stamps into milliseconds (for use with delta times)
+    static constexpr ticks_t stampsToMillis(ticks_t stamps)
+    {
+        return toMillis(stamps << CLOCK_STAMP_SHIFT);
+    }
 
     /// @brief Converts a tick count into seconds (for use with delta times)
-    static float toSeconds(unsigned long count);
+    /// @note Uses float math, keep out of hot paths
+    static constexpr float toSeconds(ticks_t count)
+    {
+        return (float)count * (1.0f / (float)CLOCK_TICKS_PER_SECOND);
+    }
 
     /// @brief Converts seconds info a tick count (for use with delta times)
-    static unsigned long fromSeconds(float seconds);
+    /// @note Only use with constants, the conversion is then done at compile time
+    static constexpr ticks_t fromSeconds(float seconds)
+    {
+        return (ticks_t)(seconds * (float)CLOCK_TICKS_PER_SECOND + 0.5f);
+    }
 } Clock;
 
 #endif
\ No newline at end of file
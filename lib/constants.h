@@ -12,10 +12,47 @@
 #define CMD_DRIVETRAIN_SET_VELOCITY 0x04
 #define CMD_DRIVETRAIN_SET_TURN_VELOCITY 0x05
 #define CMD_DRIVETRAIN_MOVE 0x06
+#define CMD_DRIVETRAIN_SET_PID_GAIN 0x07
+#define CMD_DRIVETRAIN_SET_ENCODING 0x08
+/// @brief Several commands in one transfer: [id][count] followed by [sequence][command id][data] per command.
+/// Sequence numbers start at 1 and skip 0 when they wrap, 0 means no command.
+#define CMD_DRIVETRAIN_BATCH 0x09
+
+/// @brief Set on a command id when its values use the compact wire encoding (serialize.h),
+/// only sent once the drivetrain answered with compact telemetry
+#define CMD_COMPACT 0x80
+
+/// @brief Radio packet types (packet.h)
+#define PACKET_HELLO 0x01
+/// @brief Drivetrain telemetry record (telemetrycodec.h)
+#define PACKET_TELEMETRY 0x02
+/// @brief Acknowledgement of a telemetry record: [record number]
+#define PACKET_TELEMETRY_ACK 0x03
+/// @brief Acknowledgement of reliable packets (reliablelink.h): [next expected sequence][received mask],
+/// bit i of the mask is set if sequence next + i is buffered by the receiver
+#define PACKET_ACK 0x7F
+/// @brief Set on the type of packets sent with reliable delivery
+#define PACKET_RELIABLE 0x80
 
 #define DRIVETRAIN_DIRECTION_FORWARD 1
 #define DRIVETRAIN_DIRECTION_BACKWARD 2
 
+#define DRIVETRAIN_WHEEL_FRONT_LEFT 0x01
+#define DRIVETRAIN_WHEEL_FRONT_RIGHT 0x02
+#define DRIVETRAIN_WHEEL_CENTER_LEFT 0x04
+#define DRIVETRAIN_WHEEL_CENTER_RIGHT 0x08
+#define DRIVETRAIN_WHEEL_BACK_LEFT 0x10
+#define DRIVETRAIN_WHEEL_BACK_RIGHT 0x20
+#define DRIVETRAIN_WHEEL_ALL 0x3F
+
+#define DRIVETRAIN_GAIN_P 0
+#define DRIVETRAIN_GAIN_I 1
+#define DRIVETRAIN_GAIN_D 2
+#define DRIVETRAIN_GAIN_F 3
+
+#define DRIVETRAIN_ENCODING_FULL 0
+#define DRIVETRAIN_ENCODING_COMPACT 1
+
 #define COMMAND_QUEUE_SIZE 16
 
 enum class Status
@@ -27,7 +64,7 @@ enum class Status
     CORRUPTED
 };
 
-const char *nameOfStatus(Status status)
+inline const char *nameOfStatus(Status status)
 {
     switch (status)
     {
@@ -0,0 +1,176 @@
+#include "framework.h"
+#include "controlloop.h"
+
+static ControlLoop::Task fastTask = nullptr;
+static ControlLoop::Task slowTask = nullptr;
+
+static uint8_t slowDivider = CONTROL_LOOP_SLOW_DIVIDER;
+static uint8_t slowCount = 0;
+static uint8_t period = 0;
+static uint16_t prescaler = 1;
+
+static volatile bool running = false;
+static volatile bool overrun = false;
+
+// statistics in Timer2 counts
+static volatile uint32_t ticks = 0;
+static volatile uint16_t overruns = 0;
+static volatile uint8_t lastLatency = 0;
+static volatile uint8_t minLatency = 0xFF;
+static volatile uint8_t maxLatency = 0;
+static volatile uint8_t lastRuntime = 0;
+static volatile uint8_t maxRuntime = 0;
+
+ISR(TIMER2_COMPA_vect, ISR_NOBLOCK)
+{
+    // Timer2 is cleared on compare match, so its value is the time since the tick was due
+    uint8_t start = TCNT2;
+
+    if (running)
+    {
+        // previous tick has not finished yet, skip this one
+        overrun = true;
+        overruns++;
+        return;
+    }
+    running = true;
+    overrun = false;
+
+    lastLatency = start;
+    if (start < minLatency)
+        minLatency = start;
+    if (start > maxLatency)
+        maxLatency = start;
+
+    if (fastTask != nullptr)
+        fastTask();
+
+    if (++slowCount >= slowDivider)
+    {
+        slowCount = 0;
+        if (slowTask != nullptr)
+            slowTask();
+    }
+
+    // a tick that overran its deadline wrapped the timer at least once
+    uint8_t runtime = overrun ? period : (uint8_t)(TCNT2 - start);
+    lastRuntime = runtime;
+    if (runtime > maxRuntime)
+        maxRuntime = runtime;
+
+    ticks++;
+    running = false;
+}
+
+bool ControlLoop::enable()
+{
+    return enable(CONTROL_LOOP_FREQUENCY, CONTROL_LOOP_SLOW_DIVIDER);
+}
+
+bool ControlLoop::enable(uint16_t frequency, uint8_t divider)
+{
+    static const uint16_t prescalers[] = {1, 8, 32, 64, 128, 256, 1024};
+
+    if (frequency == 0 || divider == 0)
+        return false;
+
+    // find the smallest prescaler that fits the period into the 8 bit timer
+    uint8_t cs = 0;
+    unsigned long top = 0;
+    for (uint8_t i = 0; i < sizeof(prescalers) / sizeof(prescalers[0]); i++)
+    {
+        top = F_CPU / ((unsigned long)prescalers[i] * frequency);
+        if (top > 0 && top <= 256)
+        {
+            cs = i + 1;
+            prescaler = prescalers[i];
+            break;
+        }
+    }
+
+    if (cs == 0)
+        return false;
+
+    uint8_t _SREG = SREG;
+    cli();
+    slowDivider = divider;
+    slowCount = 0;
+    period = (uint8_t)(top - 1);
+
+    TCCR2A = (1 << WGM21); // CTC mode
+    TCCR2B = cs;
+    TCNT2 = 0;
+    OCR2A = period;
+    TIFR2 = (1 << OCF2A);
+    TIMSK2 = (1 << OCIE2A);
+    SREG = _SREG;
+
+    resetStats();
+    sei();
+    return true;
+}
+
+void ControlLoop::disable()
+{
+    TIMSK2 = 0;
+    TCCR2B = 0;
+}
+
+void ControlLoop::setFastTask(Task task)
+{
+    uint8_t _SREG = SREG;
+    cli();
+    fastTask = task;
+    SREG = _SREG;
+}
+
+void ControlLoop::setSlowTask(Task task)
+{
+    uint8_t _SREG = SREG;
+    cli();
+    slowTask = task;
+    SREG = _SREG;
+}
+
+static uint16_t countsToMicros(uint16_t counts)
+{
+    return (uint16_t)((unsigned long)counts * prescaler / (F_CPU / 1000000UL));
+}
+
+ControlLoopStats ControlLoop::getStats()
+{
+    ControlLoopStats stats = {};
+
+    uint8_t _SREG = SREG;
+    cli();
+    stats.ticks = ticks;
+    stats.overruns = overruns;
+    uint8_t last = lastLatency;
+    uint8_t min = minLatency;
+    uint8_t max = maxLatency;
+    uint8_t runtime = lastRuntime;
+    uint8_t maxRun = maxRuntime;
+    SREG = _SREG;
+
+    stats.lastLatency = countsToMicros(last);
+    stats.maxLatency = countsToMicros(max);
+    stats.jitter = min <= max ? countsToMicros(max - min) : 0;
+    stats.lastRuntime = countsToMicros(runtime);
+    stats.maxRuntime = countsToMicros(maxRun);
+    stats.period = countsToMicros(period + 1);
+    return stats;
+}
+
+void ControlLoop::resetStats()
+{
+    uint8_t _SREG = SREG;
+    cli();
+    ticks = 0;
+    overruns = 0;
+    lastLatency = 0;
+    minLatency = 0xFF;
+    maxLatency = 0;
+    lastRuntime = 0;
+    maxRuntime = 0;
+    SREG = _SREG;
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef CONTROL_LOOP_H
+#define CONTROL_LOOP_H
+
+#include "framework.h"
+
+/**
+ * Default frequency in Hz of the control loop base tick (fast task rate)
+ */
+#ifndef CONTROL_LOOP_FREQUENCY
+#define CONTROL_LOOP_FREQUENCY 1000
+#endif
+
+/**
+ * Default number of base ticks between two slow task runs
+ * (200 Hz with the default base tick)
+ */
+#ifndef CONTROL_LOOP_SLOW_DIVIDER
+#define CONTROL_LOOP_SLOW_DIVIDER 5
+#endif
+
+/// @brief Timing statistics of the control loop
+typedef struct ControlLoopStats
+{
+    /// @brief Number of ticks executed since the stats were reset
+    uint32_t ticks;
+    /// @brief Number of ticks skipped because the previous tick was still running
+    uint16_t overruns;
+    /// @brief Delay between the timer compare match and the start of the last tick in microseconds
+    uint16_t lastLatency;
+    /// @brief Highest tick start delay in microseconds
+    uint16_t maxLatency;
+    /// @brief Difference between the highest and lowest tick start delay in microseconds
+    uint16_t jitter;
+    /// @brief Run time of the last tick in microseconds
+    uint16_t lastRuntime;
+    /// @brief Highest tick run time in microseconds
+    uint16_t maxRuntime;
+    /// @brief Tick period in microseconds (deadline of every tick)
+    uint16_t period;
+} ControlLoopStats;
+
+/// @brief Fixed-rate control loop driven by the Timer2 compare interrupt.
+/// @note Tasks run inside the interrupt with interrupts re-enabled, so other interrupts (I2C, USART) still get serviced.
+/// Everything a task shares with the main loop must be accessed atomically from the main loop.
+namespace ControlLoop
+{
+    /// @brief A task run by the control loop
+    typedef void (*Task)();
+
+    /// @brief Starts the control loop with the default frequency and slow task divider
+    bool enable();
+    /// @brief Starts the control loop
+    /// @param frequency The base tick frequency in Hz (fast task rate)
+    /// @param slowDivider Number of base ticks between two slow task runs
+    /// @return Returns false if the frequency can not be generated by Timer2
+    bool enable(uint16_t frequency, uint8_t slowDivider);
+    /// @brief Stops the control loop
+    void disable();
+
+    /// @brief Sets the task run on every base tick
+    void setFastTask(Task task);
+    /// @brief Sets the task run every slowDivider base ticks
+    void setSlowTask(Task task);
+
+    /// @brief Returns a snapshot of the timing statistics
+    ControlLoopStats getStats();
+    /// @brief Clears the timing statistics
+    void resetStats();
+}
+
+#endif
\ No newline at end of file
@@ -6,19 +6,57 @@
 #include "timer.h"
 #include "serialize.h"
 #include "serialterminal.h"
+#include <string.h>
+
+static_assert(DRIVETRAIN_BATCH_SIZE >= DRIVETRAIN_BATCH_HEADER_SIZE + 1 + DRIVETRAIN_MAX_COMMAND_SIZE, "a batch must fit the largest command");
 
 DebugInterface dbgdrive("Drivetrain", Version(256));
-ByteStream i2c;
 
 Drivetrain::Drivetrain(Clock *clock)
 {
     this->clock = clock;
+
+    for (uint8_t i = 0; i < DRIVETRAIN_COMMAND_SLOTS; i++)
+    {
+        commandSlots[i].transaction.callback = commandComplete;
+        commandSlots[i].transaction.context = this;
+    }
+    failedCommands = 0;
+    lastCommandError = TWIResult::Done;
+    reportedFailedCommands = 0;
+
+    batchSlot = nullptr;
+    batchLength = 0;
+    batching = false;
+    sequence = 0;
+    lastRejectedSequence = 0;
+    rejectedCommands = 0;
+
+    updateQueued = false;
+    online = false;
+    updates = 0;
+    invalidFrames = 0;
+    compact = false;
+    batchSupported = false;
+    memset(&state, 0, sizeof(state));
 }
 
 void Drivetrain::enable()
 {
     TWI::enable();
-    i2c = TWI::getStream();
+    requestCompactEncoding();
+}
+
+void Drivetrain::requestCompactEncoding()
+{
+    // old firmware ignores the command and keeps sending full frames
+    SetEncodingCommandData data = {DRIVETRAIN_ENCODING_COMPACT};
+    uint8_t cmd[SetEncodingMessage::maxSize()];
+
+    if (!sendTransfer(cmd, SetEncodingMessage::encode(cmd, data, false)))
+    {
+        dbgdrive.error_P(PSTR("setEncoding error queueing command\n"));
+    }
 }
 
 void Drivetrain::disable()
@@ -28,182 +66,321 @@ void Drivetrain::disable()
 
 void Drivetrain::setVelocity(float left, float right)
 {
-    uint8_t cmd[9];
-    cmd[0] = CMD_DRIVETRAIN_SET_VELOCITY; // id
-    encodeFloat(cmd + 1, left);
-    encodeFloat(cmd + 5, right);
-
-    if (!TWI::sendTo(DRIVETRAIN_I2C))
-    {
-        dbgdrive.error_P(PSTR("setVelocity error addressing device\n"));
-        return;
-    }
+    SetVelocityCommandData data = {left, right};
 
-    if (i2c.write(cmd, 0, 9) != 9)
+    if (!sendMessage<SetVelocityMessage>(data))
     {
-        dbgdrive.error_P(PSTR("setVelocity error sending command\n"));
+        dbgdrive.error_P(PSTR("setVelocity error queueing command\n"));
         return;
     }
 
-    TWI::endTransfer();
-
     leftVelocity = left;
     rightVelocity = right;
 }
 
 void Drivetrain::setTurnVelocity(float velocity)
 {
-    uint8_t cmd[5];
-    cmd[0] = CMD_DRIVETRAIN_SET_TURN_VELOCITY; // id
-    encodeFloat(cmd + 1, velocity);
-
-    if (!TWI::sendTo(DRIVETRAIN_I2C))
-    {
-        dbgdrive.error_P(PSTR("setTurnVelocity error addressing device\n"));
-        return;
-    }
+    SetTurnVelocityCommandData data = {velocity};
 
-    if (i2c.write(cmd, 0, 5) != 5)
+    if (!sendMessage<SetTurnVelocityMessage>(data))
     {
-        dbgdrive.error_P(PSTR("setTurnVelocity error sending command\n"));
+        dbgdrive.error_P(PSTR("setTurnVelocity error queueing command\n"));
         return;
     }
 
-    TWI::endTransfer();
-
     turnVelocity = velocity;
 }
 
 void Drivetrain::drive(Direction direction)
 {
-    uint8_t cmd[2];
-    cmd[0] = CMD_DRIVETRAIN_DRIVE; // id
-    cmd[1] = direction == Direction::Forward ? DRIVETRAIN_DIRECTION_FORWARD : DRIVETRAIN_DIRECTION_BACKWARD;
+    DriveCommandData data = {(uint8_t)(direction == Direction::Forward ? DRIVETRAIN_DIRECTION_FORWARD : DRIVETRAIN_DIRECTION_BACKWARD)};
 
-    if (!TWI::sendTo(DRIVETRAIN_I2C))
+    if (!sendMessage<DriveMessage>(data))
     {
-        dbgdrive.error_P(PSTR("drive error addressing device\n"));
+        dbgdrive.error_P(PSTR("drive error queueing command\n"));
         return;
     }
+}
 
-    if (i2c.write(cmd, 0, 2) != 2)
+void Drivetrain::stop()
+{
+    if (!sendMessage<StopMessage>(NoData()))
     {
-        dbgdrive.error_P(PSTR("drive error sending command\n"));
+        dbgdrive.error_P(PSTR("stop error queueing command\n"));
         return;
     }
-
-    TWI::endTransfer();
 }
 
-void Drivetrain::stop()
+void Drivetrain::turn(float angle)
 {
-    uint8_t cmd[1];
-    cmd[0] = CMD_DRIVETRAIN_STOP; // id
+    TurnCommandData data = {angle};
 
-    if (!TWI::sendTo(DRIVETRAIN_I2C))
+    if (!sendMessage<TurnMessage>(data))
     {
-        dbgdrive.error_P(PSTR("stop error addressing device\n"));
+        dbgdrive.error_P(PSTR("turn error queueing command\n"));
         return;
     }
+}
+
+void Drivetrain::move(float distance)
+{
+    MoveCommandData data = {distance};
 
-    if (i2c.write(cmd, 0, 1) != 1)
+    if (!sendMessage<MoveMessage>(data))
     {
-        dbgdrive.error_P(PSTR("stop error sending command\n"));
+        dbgdrive.error_P(PSTR("move error queueing command\n"));
         return;
     }
-
-    TWI::endTransfer();
 }
 
-void Drivetrain::turn(float angle)
+void Drivetrain::setWheelGain(uint8_t wheels, PIDGain gain, float value)
 {
-    uint8_t cmd[5];
-    cmd[0] = CMD_DRIVETRAIN_TURN; // id
-    encodeFloat(cmd + 1, angle);
-
-    if (!TWI::sendTo(DRIVETRAIN_I2C))
+    SetPIDGainCommandData data;
+    data.wheels = wheels;
+    switch (gain)
     {
-        dbgdrive.error_P(PSTR("turn error addressing device\n"));
-        return;
+    case PIDGain::P:
+        data.gain = DRIVETRAIN_GAIN_P;
+        break;
+    case PIDGain::I:
+        data.gain = DRIVETRAIN_GAIN_I;
+        break;
+    case PIDGain::D:
+        data.gain = DRIVETRAIN_GAIN_D;
+        break;
+    case PIDGain::F:
+        data.gain = DRIVETRAIN_GAIN_F;
+        break;
     }
+    data.value = value;
 
-    if (i2c.write(cmd, 0, 5) != 5)
+    if (!sendMessage<SetPIDGainMessage>(data))
     {
-        dbgdrive.error_P(PSTR("turn error sending command\n"));
+        dbgdrive.error_P(PSTR("setWheelGain error queueing command\n"));
         return;
     }
+}
+
+void Drivetrain::setWheelGains(uint8_t wheels, float P, float I, float D, float F)
+{
+    setWheelGain(wheels, PIDGain::P, P);
+    setWheelGain(wheels, PIDGain::I, I);
+    setWheelGain(wheels, PIDGain::D, D);
+    setWheelGain(wheels, PIDGain::F, F);
+}
 
-    TWI::endTransfer();
+void Drivetrain::beginBatch()
+{
+    batching = true;
 }
 
-void Drivetrain::move(float distance)
+uint8_t Drivetrain::endBatch()
+{
+    batching = false;
+    if (batchSlot == nullptr)
+        return 0;
+    return flushBatch() ? sequence : 0;
+}
+
+uint8_t Drivetrain::getLastSequence()
+{
+    return sequence;
+}
+
+bool Drivetrain::isAccepted(uint8_t sequence)
+{
+    // sequence numbers wrap, anything up to half the range behind the reported one counts as older
+    return sequence != 0 && state.acceptedSequence != 0 && (int8_t)(state.acceptedSequence - sequence) >= 0;
+}
+
+bool Drivetrain::isCompleted(uint8_t sequence)
+{
+    return sequence != 0 && state.completedSequence != 0 && (int8_t)(state.completedSequence - sequence) >= 0;
+}
+
+uint16_t Drivetrain::getRejectedCommands()
 {
-    uint8_t cmd[5];
-    cmd[0] = CMD_DRIVETRAIN_MOVE; // id
-    encodeFloat(cmd + 1, distance);
+    return rejectedCommands;
+}
+
+bool Drivetrain::sendCommand(const uint8_t *cmd, uint8_t count)
+{
+    // older drivetrains only know single commands without a sequence number
+    if (!batchSupported)
+        return sendTransfer(cmd, count);
+
+    if (batchSlot != nullptr && batchLength + 1 + count > DRIVETRAIN_BATCH_SIZE && !flushBatch())
+        return false;
 
-    if (!TWI::sendTo(DRIVETRAIN_I2C))
+    if (batchSlot == nullptr)
     {
-        dbgdrive.error_P(PSTR("move error addressing device\n"));
-        return;
+        // the batch is collected right in the buffer it is sent from
+        batchSlot = freeSlot();
+        if (batchSlot == nullptr)
+            return false;
+        batchSlot->data[0] = CMD_DRIVETRAIN_BATCH; // id
+        batchSlot->data[1] = 0;                    // count
+        batchLength = DRIVETRAIN_BATCH_HEADER_SIZE;
     }
 
-    if (i2c.write(cmd, 0, 5) != 5)
+    if (++sequence == 0)
+        sequence = 1;
+    uint8_t *batch = batchSlot->data;
+    batch[batchLength++] = sequence;
+    memcpy(batch + batchLength, cmd, count);
+    batchLength += count;
+    batch[1]++;
+
+    return batching || flushBatch();
+}
+
+bool Drivetrain::flushBatch()
+{
+    // a batch that could not be queued is dropped, its sequence numbers are never accepted
+    bool ok = TWI::sendTo(DRIVETRAIN_I2C, batchSlot->data, batchLength, &batchSlot->transaction);
+    batchSlot = nullptr;
+    batchLength = 0;
+    return ok;
+}
+
+DrivetrainCommandSlot *Drivetrain::freeSlot()
+{
+    for (uint8_t i = 0; i < DRIVETRAIN_COMMAND_SLOTS; i++)
     {
-        dbgdrive.error_P(PSTR("move error sending command\n"));
-        return;
+        DrivetrainCommandSlot *slot = &commandSlots[i];
+        if (slot != batchSlot && slot->transaction.result != TWIResult::Pending)
+            return slot;
     }
+    return nullptr;
+}
+
+bool Drivetrain::sendTransfer(const uint8_t *data, uint8_t count)
+{
+    DrivetrainCommandSlot *slot = freeSlot();
+    if (slot == nullptr)
+        return false;
 
-    TWI::endTransfer();
+    memcpy(slot->data, data, count);
+    return TWI::sendTo(DRIVETRAIN_I2C, slot->data, count, &slot->transaction);
 }
 
-bool Drivetrain::requestUpdate()
+void Drivetrain::commandComplete(TWITransaction *transaction)
 {
-    uint8_t buf[4];
+    if (transaction->result != TWIResult::Done)
+    {
+        Drivetrain *drivetrain = (Drivetrain *)transaction->context;
+        drivetrain->failedCommands++;
+        drivetrain->lastCommandError = transaction->result;
+    }
+}
 
-    if (!TWI::requestFrom(DRIVETRAIN_I2C))
+bool Drivetrain::requestUpdate()
+{
+    if (updateQueued)
         return false;
 
-    // read the current motor speeds
-    if (i2c.read(buf, 0, 4, true) != 4)
-        return false;
-    frontLeftSpeed = decodeFloat(buf);
-    if (i2c.read(buf, 0, 4, true) != 4)
-        return false;
-    frontRightSpeed = decodeFloat(buf);
-    if (i2c.read(buf, 0, 4, true) != 4)
-        return false;
-    centerLeftSpeed = decodeFloat(buf);
-    if (i2c.read(buf, 0, 4, true) != 4)
-        return false;
-    centerRightSpeed = decodeFloat(buf);
-    if (i2c.read(buf, 0, 4, true) != 4)
-        return false;
-    backLeftSpeed = decodeFloat(buf);
-    if (i2c.read(buf, 0, 4, true) != 4)
-        return false;
-    backRightSpeed = decodeFloat(buf);
+    updateQueued = TWI::requestFrom(DRIVETRAIN_I2C, (uint8_t *)&frame,
+                                     compact ? sizeof(frame.compact) : sizeof(frame.full), &updateTransaction);
+    return updateQueued;
+}
 
-    // read the current command id
-    if (i2c.read(buf, 0, 1, true) != 1)
-        return false;
-    currentCommandId = buf[0];
+bool Drivetrain::poll()
+{
+    TWI::poll();
+
+    uint8_t _SREG = SREG;
+    cli();
+    uint16_t failed = failedCommands;
+    TWIResult error = lastCommandError;
+    SREG = _SREG;
+    if (failed != reportedFailedCommands)
+    {
+        reportedFailedCommands = failed;
+        dbgdrive.error_P(PSTR("command failed with %S (%u total)\n"), TWI::nameOfResult(error), failed);
+    }
 
-    // read the left and right drivetrain power
-    if (i2c.read(buf, 0, 4, true) != 4)
-        return false;
-    currentLeftPower = decodeFloat(buf);
-    if (i2c.read(buf, 0, 4, true) != 4)
+    if (!updateQueued || updateTransaction.result == TWIResult::Pending)
         return false;
-    currentRightPower = decodeFloat(buf);
 
-    // read the current angle
-    if (i2c.read(buf, 0, 4, false) != 4)
-        return false;
-    currentAngle = decodeFloat(buf);
+    updateQueued = false;
+    online = updateTransaction.result == TWIResult::Done;
+    if (online)
+    {
+        // a torn or outdated frame keeps the previous state
+        bool sequenced = true;
+        if (frame.compact.version == TELEMETRY_VERSION_COMPACT && frame.compact.isValid())
+        {
+            frame.compact.payload.unpack(&state);
+            compact = true;
+        }
+        else if (frame.compact.version == TELEMETRY_VERSION_COMPACT_UNSEQUENCED && frame.compact.isValidUnsequenced())
+        {
+            frame.compact.payload.unpack(&state);
+            compact = true;
+            sequenced = false;
+        }
+        else if (!compact && frame.full.isValid())
+        {
+            state = frame.full.payload;
+        }
+        else if (!compact && frame.full.isValidUnsequenced())
+        {
+            state = frame.full.payload;
+            sequenced = false;
+        }
+        else
+        {
+            invalidFrames++;
+            dbgdrive.warn_P(PSTR("dropped invalid telemetry frame (version %u, length %u)\n"), frame.full.version, frame.full.length);
+
+            if (compact && (frame.full.version == TELEMETRY_VERSION || frame.full.version == TELEMETRY_VERSION_UNSEQUENCED))
+            {
+                // the drivetrain restarted with the full encoding, read full frames until it switched again
+                compact = false;
+                requestCompactEncoding();
+            }
+            sequenced = batchSupported;
+        }
+
+        if (!sequenced)
+        {
+            // the bytes after the shorter payload are the CRC and padding, not sequence numbers
+            state.acceptedSequence = 0;
+            state.completedSequence = 0;
+            state.rejectedSequence = 0;
+        }
+        batchSupported = sequenced;
+    }
+    if (batchSupported && state.rejectedSequence != lastRejectedSequence)
+    {
+        lastRejectedSequence = state.rejectedSequence;
+        rejectedCommands++;
+        dbgdrive.warn_P(PSTR("commands after sequence %u up to %u rejected\n"), state.acceptedSequence, state.rejectedSequence);
+    }
+
+    updates++;
     return true;
 }
 
+bool Drivetrain::isOnline()
+{
+    return online;
+}
+
+uint16_t Drivetrain::getInvalidFrames()
+{
+    return invalidFrames;
+}
+
+uint16_t Drivetrain::getFailedCommands()
+{
+    uint8_t _SREG = SREG;
+    cli();
+    uint16_t failed = failedCommands;
+    SREG = _SREG;
+    return failed;
+}
+
 void Drivetrain::logTelemetry()
 {
     char buf[10];
@@ -211,83 +388,109 @@ void Drivetrain::logTelemetry()
     // SerialTerminal::hideCursor();
     // SerialTerminal::moveCursor(1, 1);
 
-    ftoa(69.0f, buf, 20, 4);
-    dbgdrive.info("leftPower: %", buf);
+    ftoa(state.leftPower, buf, sizeof(buf), 4);
+    dbgdrive.info_P(PSTR("leftPower: %s"), buf);
     SerialTerminal::eraseFromCursorEndLine();
     SerialTerminal::moveCursorToNextLine(1);
-    ftoa(currentRightPower, buf, 20, 4);
-    dbgdrive.info("rightPower: %s", buf);
+    ftoa(state.rightPower, buf, sizeof(buf), 4);
+    dbgdrive.info_P(PSTR("rightPower: %s"), buf);
     SerialTerminal::eraseFromCursorEndLine();
     SerialTerminal::moveCursorToNextLine(1);
-    dbgdrive.info("currentCommand: %u", currentCommandId);
+    dbgdrive.info_P(PSTR("currentCommand: %u"), state.commandId);
     SerialTerminal::eraseFromCursorEndLine();
     SerialTerminal::moveCursorToNextLine(1);
-    ftoa(currentAngle, buf, 20, 4);
-    dbgdrive.info("angle: %s", buf);
+    ftoa(state.angle, buf, sizeof(buf), 4);
+    dbgdrive.info_P(PSTR("angle: %s"), buf);
     SerialTerminal::eraseFromCursorEndLine();
     SerialTerminal::moveCursorToNextLine(1);
-    ftoa(frontLeftSpeed, buf, 20, 4);
-    dbgdrive.info("frontLeftSpeed: %s", buf);
+    ftoa(state.frontLeftSpeed, buf, sizeof(buf), 4);
+    dbgdrive.info_P(PSTR("frontLeftSpeed: %s"), buf);
     SerialTerminal::eraseFromCursorEndLine();
     SerialTerminal::moveCursorToNextLine(1);
-    ftoa(frontRightSpeed, buf, 20, 4);
-    dbgdrive.info("frontRightSpeed: %s", buf);
+    ftoa(state.frontRightSpeed, buf, sizeof(buf), 4);
+    dbgdrive.info_P(PSTR("frontRightSpeed: %s"), buf);
     SerialTerminal::eraseFromCursorEndLine();
     SerialTerminal::moveCursorToNextLine(1);
-    ftoa(centerLeftSpeed, buf, 20, 4);
-    dbgdrive.info("centerLeftSpeed: %s", buf);
+    ftoa(state.centerLeftSpeed, buf, sizeof(buf), 4);
+    dbgdrive.info_P(PSTR("centerLeftSpeed: %s"), buf);
     SerialTerminal::eraseFromCursorEndLine();
     SerialTerminal::moveCursorToNextLine(1);
-    ftoa(centerRightSpeed, buf, 20, 4);
-    dbgdrive.info("centerRightSpeed: %s", buf);
+    ftoa(state.centerRightSpeed, buf, sizeof(buf), 4);
+    dbgdrive.info_P(PSTR("centerRightSpeed: %s"), buf);
     SerialTerminal::eraseFromCursorEndLine();
     SerialTerminal::moveCursorToNextLine(1);
-    ftoa(backLeftSpeed, buf, 20, 4);
-    dbgdrive.info("backLeftSpeed: %s", buf);
+    ftoa(state.backLeftSpeed, buf, sizeof(buf), 4);
+    dbgdrive.info_P(PSTR("backLeftSpeed: %s"), buf);
     SerialTerminal::eraseFromCursorEndLine();
     SerialTerminal::moveCursorToNextLine(1);
-    ftoa(backRightSpeed, buf, 20, 4);
-    dbgdrive.info("backRightSpeed: %s", buf);
+    ftoa(state.backRightSpeed, buf, sizeof(buf), 4);
+    dbgdrive.info_P(PSTR("backRightSpeed: %s"), buf);
     SerialTerminal::eraseFromCursorEndLine();
     SerialTerminal::moveCursorToNextLine(1);
 
     // SerialTerminal::showCursor();
 }
 
+const DrivetrainTelemetry &Drivetrain::getTelemetry()
+{
+    return state;
+}
+
 float Drivetrain::getLeftPower()
 {
-    return currentLeftPower;
+    return state.leftPower;
 }
 
 float Drivetrain::getRightPower()
 {
-    return currentRightPower;
+    return state.rightPower;
 }
 
 uint8_t Drivetrain::currentCommand()
 {
-    return currentCommandId;
+    return state.commandId;
 }
 
 bool Drivetrain::isBusy()
 {
-    return currentCommandId != CMD_NONE;
+    return state.commandId != CMD_NONE;
 }
 
-void Drivetrain::waitUntilAvailable()
+bool Drivetrain::waitUntilAvailable(Scheduler *scheduler)
 {
     Timer timer(clock);
+    const Time pollInterval = Time::fromMillis(1000);
     do
     {
-        if (!requestUpdate())
+        // wait for a fresh update, the scheduler tasks may be polling as well
+        uint16_t lastUpdate = updates;
+        // a refused read (bus in slave mode or a blocking transfer open) would never finish
+        if (!requestUpdate() && !updateQueued)
+        {
+            dbgdrive.error_P(PSTR("requestUpdate refused by the bus\n"));
+            return false;
+        }
+        while (updates == lastUpdate)
+        {
+            poll();
+            scheduler->poll();
+        }
+        if (!online)
         {
             dbgdrive.error_P(PSTR("requestUpdate failed!"));
-            while (1)
-                ;
+            return false;
         }
         logTelemetry();
-        timer.spinWait(Time::fromSeconds(1.0f));
-    } while (!isBusy());
+
+        timer.restart();
+        while (!timer.elapsed(pollInterval))
+        {
+            poll();
+            scheduler->poll();
+        }
+    } while (isBusy());
+
+    return true;
 }
 
 float Drivetrain::getLeftVelocity()
@@ -307,5 +510,5 @@ float Drivetrain::getTurnVelocity()
 
 float Drivetrain::getAngle()
 {
-    return currentAngle;
+    return state.angle;
 }
\ No newline at end of file
@@ -2,6 +2,28 @@
 #define _DRIVETRAIN_H_
 
 #include "clock.h"
+#include "scheduler.h"
+#include "i2c.h"
+#include "constants.h"
+#include "telemetry.h"
+#include "messages.h"
+
+/**
+ * Number of transfers that can be queued on the I2C bus at the same time, a batch being collected holds one of them
+ */
+#ifndef DRIVETRAIN_COMMAND_SLOTS
+#define DRIVETRAIN_COMMAND_SLOTS 2
+#endif
+
+/**
+ * Maximum size of a command batch in bytes, must fit the receive buffer of the drivetrain (TWI_SLAVE_RX_BUFFER_SIZE)
+ */
+#ifndef DRIVETRAIN_BATCH_SIZE
+#define DRIVETRAIN_BATCH_SIZE 32
+#endif
+
+/// @brief Size of the batch header (id and count)
+#define DRIVETRAIN_BATCH_HEADER_SIZE 2
 
 enum class Direction
 {
@@ -9,6 +31,26 @@ enum class Direction
     Backward
 };
 
+enum class PIDGain
+{
+    P,
+    I,
+    D,
+    F
+};
+
+/// @brief A command queued on the I2C bus with its own copy of the data
+typedef struct DrivetrainCommandSlot
+{
+    TWITransaction transaction;
+    uint8_t data[DRIVETRAIN_BATCH_SIZE];
+} DrivetrainCommandSlot;
+
+/// @brief Remote control of the drivetrain board.
+/// @note Commands and telemetry reads are queued on the I2C bus and return immediately, call poll() regularly.
+/// Every command gets a sequence number, the drivetrain reports the accepted and completed sequences in its telemetry.
+/// Batches and sequence numbers are only used once the telemetry shows the drivetrain supports them,
+/// until then (and for older drivetrains) commands are sent one by one.
 typedef struct Drivetrain
 {
     Drivetrain(Clock *clock);
@@ -23,36 +65,117 @@ typedef struct Drivetrain
     void turn(float angle);
     void move(float distance);
 
+    /// @brief Sets one gain of the wheel PID controllers at runtime
+    /// @param wheels Mask of the wheels to update (DRIVETRAIN_WHEEL_* constants)
+    /// @param gain The gain to set
+    /// @param value The new gain value
+    void setWheelGain(uint8_t wheels, PIDGain gain, float value);
+    /// @brief Sets all gains of the wheel PID controllers at runtime
+    /// @param wheels Mask of the wheels to update (DRIVETRAIN_WHEEL_* constants)
+    void setWheelGains(uint8_t wheels, float P, float I, float D, float F);
+
+    /// @brief Collects the following commands into one transfer until endBatch() is called.
+    /// A batch that gets full is sent early and a new one is started.
+    void beginBatch();
+    /// @brief Sends the commands collected since beginBatch()
+    /// @return Returns the sequence number of the last command, 0 if no command was collected, the batch could not be queued
+    /// or the drivetrain does not support batches
+    uint8_t endBatch();
+    /// @brief Returns the sequence number of the last command sent
+    uint8_t getLastSequence();
+    /// @brief Returns true if the drivetrain added the command with the sequence number to its queue (from the last telemetry)
+    bool isAccepted(uint8_t sequence);
+    /// @brief Returns true if the drivetrain finished the command with the sequence number (from the last telemetry)
+    bool isCompleted(uint8_t sequence);
+    /// @brief Returns the number of times the drivetrain reported rejected commands
+    uint16_t getRejectedCommands();
+
+    /// @brief Queues a telemetry read
+    /// @return Returns false if the previous read is still running
     bool requestUpdate();
+    /// @brief Processes finished I2C transactions, call regularly from the main loop
+    /// @return Returns true if a telemetry read finished (successful or not)
+    bool poll();
+    /// @brief Returns true if the last telemetry read succeeded
+    bool isOnline();
+    /// @brief Returns the number of commands that failed on the bus
+    uint16_t getFailedCommands();
+    /// @brief Returns the number of telemetry frames dropped for a bad version, length or CRC
+    uint16_t getInvalidFrames();
     void logTelemetry();
+    /// @brief Returns the last valid telemetry received
+    const DrivetrainTelemetry &getTelemetry();
 
     float getLeftPower();
     float getRightPower();
     uint8_t currentCommand();
     bool isBusy();
-    void waitUntilAvailable();
+    /// @brief Polls the drivetrain until its command queue is empty
+    /// @param scheduler Scheduler polled while waiting, so other tasks keep running
+    /// @return Returns false if the drivetrain could not be polled
+    bool waitUntilAvailable(Scheduler *scheduler);
     float getLeftVelocity();
     float getRightVelocity();
     float getTurnVelocity();
     float getAngle();
 
 private:
+    /// @brief Encodes a command, in the compact encoding once the drivetrain uses it, and adds it to the batch
+    template <typename Message>
+    bool sendMessage(const typename Message::Data &data)
+    {
+        uint8_t cmd[Message::maxSize()];
+        return sendCommand(cmd, Message::encode(cmd, data, compact));
+    }
+    /// @brief Adds a command to the batch with the next sequence number, the batch is sent right away outside beginBatch/endBatch.
+    /// Sends the plain command instead if the drivetrain does not support batches.
+    bool sendCommand(const uint8_t *cmd, uint8_t count);
+    /// @brief Queues the collected batch
+    bool flushBatch();
+    /// @brief Returns a slot that is neither queued nor collecting the batch, nullptr if there is none
+    DrivetrainCommandSlot *freeSlot();
+    /// @brief Copies a transfer into a free slot and queues it
+    bool sendTransfer(const uint8_t *data, uint8_t count);
+    /// @brief Asks the drivetrain to switch to the compact wire encoding
+    void requestCompactEncoding();
+    static void commandComplete(TWITransaction *transaction);
+
     Clock *clock;
 
-    float currentLeftPower;
-    float currentRightPower;
-    uint8_t currentCommandId;
+    DrivetrainCommandSlot commandSlots[DRIVETRAIN_COMMAND_SLOTS];
+    volatile uint16_t failedCommands;
+    volatile TWIResult lastCommandError;
+    uint16_t reportedFailedCommands;
+
+    /// @brief Slot the batch is collected in, nullptr until the first command of a batch
+    DrivetrainCommandSlot *batchSlot;
+    uint8_t batchLength;
+    bool batching;
+    uint8_t sequence;
+    uint8_t lastRejectedSequence;
+    uint16_t rejectedCommands;
+
+    TWITransaction updateTransaction;
+    /// @brief Telemetry read buffer, the version byte tells the encodings apart
+    union
+    {
+        TelemetryFrame full;
+        CompactTelemetryFrame compact;
+    } frame;
+    /// @brief Set once the drivetrain answered with a compact frame, commands and reads then use the compact encoding
+    bool compact;
+    /// @brief Set while the drivetrain sends telemetry with sequence numbers, commands are batched only then
+    bool batchSupported;
+    bool updateQueued;
+    bool online;
+    uint16_t updates;
+    uint16_t invalidFrames;
+
+    /// @brief Last valid telemetry received
+    DrivetrainTelemetry state;
     float leftVelocity;
     float rightVelocity;
     float turnVelocity;
-    float currentAngle;
-
-    float frontLeftSpeed;
-    float frontRightSpeed;
-    float centerLeftSpeed;
-    float centerRightSpeed;
-    float backLeftSpeed;
-    float backRightSpeed;
 } Drivetrain;
 
 #endif
\ No newline at end of file
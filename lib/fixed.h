@@ -0,0 +1,176 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+/// @brief Storage types of a fixed-point number with the given total bit count
+template <uint8_t Bits>
+struct FixedStorage;
+
+template <>
+struct FixedStorage<16>
+{
+    typedef int16_t type;
+    typedef uint16_t utype;
+    typedef int32_t wide;
+};
+
+template <>
+struct FixedStorage<32>
+{
+    typedef int32_t type;
+    typedef uint32_t utype;
+    typedef int64_t wide;
+};
+
+/// @brief Signed fixed-point number with saturating arithmetic
+/// @note Addition and subtraction stay in the storage width, only multiplication and division widen
+/// @tparam IntBits Number of integer bits (including the sign bit)
+/// @tparam FracBits Number of fractional bits
+template <uint8_t IntBits, uint8_t FracBits>
+struct Fixed
+{
+    typedef typename FixedStorage<IntBits + FracBits>::type raw_t;
+    typedef typename FixedStorage<IntBits + FracBits>::utype uraw_t;
+    typedef typename FixedStorage<IntBits + FracBits>::wide wide_t;
+
+    static constexpr uint8_t fracBits = FracBits;
+    static constexpr raw_t rawMax = (raw_t)(((wide_t)1 << (IntBits + FracBits - 1)) - 1);
+    static constexpr raw_t rawMin = (raw_t)(-((wide_t)1 << (IntBits + FracBits - 1)));
+    static constexpr wide_t rawOne = (wide_t)1 << FracBits;
+
+    raw_t raw;
+
+    constexpr Fixed() : raw(0) {}
+
+    /// @brief Converts a float into a fixed-point number (saturates)
+    /// @note Only use with constants, the conversion is then done at compile time
+    constexpr explicit Fixed(float value)
+        : raw(value >= (float)rawMax / (float)rawOne    ? rawMax
+              : value <= (float)rawMin / (float)rawOne ? rawMin
+                                                       : (raw_t)(value * (float)rawOne + (value >= 0 ? 0.5f : -0.5f)))
+    {
+    }
+
+    /// @brief Converts an integer into a fixed-point number (saturates)
+    static constexpr Fixed fromInt(int32_t value)
+    {
+        return fromWide((wide_t)value << FracBits);
+    }
+
+    /// @brief Creates a fixed-point number from its raw representation
+    static constexpr Fixed fromRaw(raw_t raw)
+    {
+        return Fixed(raw, 0);
+    }
+
+    /// @brief Creates a fixed-point number from a wider raw value, saturating to the range
+    static constexpr Fixed fromWide(wide_t value)
+    {
+        return Fixed(value > rawMax   ? rawMax
+                     : value < rawMin ? rawMin
+                                      : (raw_t)value,
+                     0);
+    }
+
+    static constexpr Fixed max() { return fromRaw(rawMax); }
+    static constexpr Fixed min() { return fromRaw(rawMin); }
+
+    /// @note Uses float math, keep out of hot paths
+    constexpr float toFloat() const
+    {
+        return (float)raw / (float)rawOne;
+    }
+
+    /// @brief Returns the integer part (rounded towards negative infinity)
+    constexpr raw_t toInt() const
+    {
+        return raw >> FracBits;
+    }
+
+    constexpr Fixed operator+(const Fixed &other) const
+    {
+        return add(raw, other.raw);
+    }
+
+    constexpr Fixed operator-(const Fixed &other) const
+    {
+        return subtract(raw, other.raw);
+    }
+
+    constexpr Fixed operator-() const
+    {
+        return raw == rawMin ? max() : fromRaw(-raw);
+    }
+
+    constexpr Fixed operator*(const Fixed &other) const
+    {
+        return fromWide(((wide_t)raw * other.raw) >> FracBits);
+    }
+
+    /// @note Division by zero saturates towards the sign of the dividend
+    constexpr Fixed operator/(const Fixed &other) const
+    {
+        return other.raw == 0 ? (raw >= 0 ? max() : min())
+                              : fromWide(((wide_t)raw << FracBits) / other.raw);
+    }
+
+    Fixed &operator+=(const Fixed &other) { return *this = *this + other; }
+    Fixed &operator-=(const Fixed &other) { return *this = *this - other; }
+    Fixed &operator*=(const Fixed &other) { return *this = *this * other; }
+    Fixed &operator/=(const Fixed &other) { return *this = *this / other; }
+
+    constexpr bool operator<(const Fixed &other) const { return raw < other.raw; }
+    constexpr bool operator<=(const Fixed &other) const { return raw <= other.raw; }
+    constexpr bool operator>(const Fixed &other) const { return raw > other.raw; }
+    constexpr bool operator>=(const Fixed &other) const { return raw >= other.raw; }
+    constexpr bool operator==(const Fixed &other) const { return raw == other.raw; }
+    constexpr bool operator!=(const Fixed &other) const { return raw != other.raw; }
+
+private:
+    constexpr Fixed(raw_t raw, int) : raw(raw) {}
+
+    /// @brief Adds in the storage width, the sum overflowed if its sign differs from the sign of both operands
+    static constexpr Fixed add(raw_t a, raw_t b)
+    {
+        return saturateOverflow((raw_t)(uraw_t)((uraw_t)a + (uraw_t)b), a, b);
+    }
+
+    /// @brief Subtracts in the storage width, the difference overflowed if the operands have different signs
+    /// and the sign of the difference differs from the sign of a
+    static constexpr Fixed subtract(raw_t a, raw_t b)
+    {
+        return saturateOverflow((raw_t)(uraw_t)((uraw_t)a - (uraw_t)b), a, (raw_t)~b);
+    }
+
+    /// @param result The wrapped result of an operation on a and b, it overflowed if a and b have the same sign and result does not
+    static constexpr Fixed saturateOverflow(raw_t result, raw_t a, raw_t b)
+    {
+        return ((result ^ a) & (result ^ b)) < 0 ? (a < 0 ? min() : max()) : fromRaw(result);
+    }
+};
+
+/// @brief Q1.15 fixed-point number (range [-1, 1))
+typedef Fixed<1, 15> Q15;
+/// @brief Q16.16 fixed-point number (range [-32768, 32768))
+typedef Fixed<16, 16> Q16_16;
+
+template <uint8_t IntBits, uint8_t FracBits>
+constexpr Fixed<IntBits, FracBits> fabs(const Fixed<IntBits, FracBits> &value)
+{
+    return value.raw < 0 ? -value : value;
+}
+
+template <uint8_t IntBits, uint8_t FracBits>
+constexpr Fixed<IntBits, FracBits> fmin(const Fixed<IntBits, FracBits> &a, const Fixed<IntBits, FracBits> &b)
+{
+    return a < b ? a : b;
+}
+
+template <uint8_t IntBits, uint8_t FracBits>
+constexpr Fixed<IntBits, FracBits> fmax(const Fixed<IntBits, FracBits> &a, const Fixed<IntBits, FracBits> &b)
+{
+    return a > b ? a : b;
+}
+
+#endif
\ No newline at end of file
@@ -4,100 +4,373 @@
 #include "internal/i2cmaster.h"
 #include "internal/i2cslave.h"
 #include "serialdebug.h"
+#include "ringbuffer.h"
+#include <string.h>
 
 static bool isTransfering = false;
+static TWISpeed currentSpeed = TWISpeed::Standard;
 static bool isSlave = false;
 static volatile bool slaveRequested = false;
-#define RECV_BUFFER_SIZE 16
-static volatile uint8_t recv_buffer[RECV_BUFFER_SIZE];
-static volatile uint8_t recv_buffer_put_pos = 0;
-static volatile uint8_t recv_buffer_get_pos = 0;
-static volatile uint8_t recv_buffer_len = 0;
+RingBuffer<uint8_t, TWI_SLAVE_RX_BUFFER_SIZE> TWISlaveReceive::buffer;
+RingBuffer<uint8_t, TWI_SLAVE_RX_MESSAGES> TWISlaveReceive::messages;
+uint8_t TWISlaveReceive::messageRead = 0;
+/// @brief Set while the master writes a message
+static volatile bool recv_in_message = false;
+/// @brief Set if the message being written is dropped because no more messages can be tracked
+static volatile bool recv_discarding = false;
+/// @brief Bytes of the message being written that were stored
+static volatile uint8_t recv_current = 0;
+static volatile uint16_t recv_dropped = 0;
+
+// published slave transmit data, the interrupt serves the front buffer
+#define TX_NONE 0xFF
+static uint8_t tx_buffers[2][TWI_SLAVE_TX_BUFFER_SIZE];
+static volatile uint8_t tx_length[2] = {0, 0};
+static volatile uint8_t tx_front = 0;
+static volatile uint8_t tx_active = TX_NONE;
+static uint8_t tx_pos = 0;
+
+// queued master transactions, the head is the one running on the bus
+static TWITransaction *volatile queueHead = nullptr;
+static TWITransaction *volatile queueTail = nullptr;
+
+#define TWCR_MASTER ((1 << TWINT) | (1 << TWEN) | (1 << TWIE))
 
 void recv(uint8_t data)
 {
-    recv_buffer[recv_buffer_put_pos++] = data;
-    recv_buffer_len++;
-    if (recv_buffer_put_pos >= RECV_BUFFER_SIZE)
+    // a message that can not be tracked is dropped as a whole
+    if (!recv_in_message)
     {
-        recv_buffer_put_pos = 0;
+        recv_in_message = true;
+        recv_discarding = TWISlaveReceive::messages.isFull();
     }
+    if (recv_discarding)
+    {
+        recv_dropped++;
+        return;
+    }
+
+    // bytes that do not fit are counted by the buffer, the message arrives truncated and fails to parse
+    if (TWISlaveReceive::buffer.push(data))
+        recv_current++;
 }
 
-void req()
+uint8_t req(uint8_t first)
 {
-    slaveRequested = true;
+    if (first)
+    {
+        // latch the buffer so a publish during the transfer can not tear it
+        tx_active = tx_front;
+        tx_pos = 0;
+        slaveRequested = true;
+    }
+
+    if (tx_active == TX_NONE || tx_pos >= tx_length[tx_active])
+        return 0xFF;
+    return tx_buffers[tx_active][tx_pos++];
 }
 
-static int sput(uint8_t data, ByteStream *stream)
+void end()
 {
-    if (isSlave)
+    tx_active = TX_NONE;
+
+    if (recv_in_message)
     {
-        I2C_transmitByte(data);
-        return 1;
+        uint8_t length = recv_current;
+        if (!recv_discarding && length > 0)
+            TWISlaveReceive::messages.push(length);
+        recv_in_message = false;
+        recv_current = 0;
     }
-    else
+}
+
+/// @brief Issues the start condition of the transaction at the head of the queue
+/// @param stop Send a stop condition first to release the bus
+static void startNext(bool stop)
+{
+    TWITransaction *transaction = queueHead;
+    if (transaction == nullptr)
     {
-        if (i2c_write(data) == 1)
-        {
-            return -1;
-        }
-        return 1;
+        // idle, interrupt disabled so the blocking master functions can use the bus
+        TWCR = (1 << TWINT) | (1 << TWEN) | (stop ? (1 << TWSTO) : 0);
+        return;
     }
+
+    transaction->position = 0;
+    transaction->retries = 0;
+    transaction->deadline = Clock::counter() + transaction->timeout.asTicks();
+    TWCR = TWCR_MASTER | (1 << TWSTA) | (stop ? (1 << TWSTO) : 0);
 }
 
-static int sget(ByteStream *stream, bool last)
+/// @brief Completes the running transaction and starts the next one
+static void finish(TWIResult result, bool stop)
 {
-    if (isSlave)
+    TWITransaction *transaction = queueHead;
+    queueHead = transaction->next;
+    if (queueHead == nullptr)
+        queueTail = nullptr;
+    transaction->next = nullptr;
+
+    transaction->result = result;
+    if (transaction->callback)
+        transaction->callback(transaction);
+
+    startNext(stop);
+}
+
+static void masterInterrupt()
+{
+    TWITransaction *transaction = queueHead;
+    if (transaction == nullptr)
     {
-        if (recv_buffer_len > 0)
+        TWCR = (1 << TWINT) | (1 << TWEN);
+        return;
+    }
+
+    uint8_t readIndex = transaction->position - transaction->writeLength;
+
+    switch (TW_STATUS)
+    {
+    case TW_START:
+    case TW_REP_START:
+        if (transaction->position < transaction->writeLength || transaction->readLength == 0)
+            TWDR = (transaction->address & 0xFE) | TW_WRITE;
+        else
+            TWDR = (transaction->address & 0xFE) | TW_READ;
+        TWCR = TWCR_MASTER;
+        break;
+    case TW_MT_SLA_ACK:
+    case TW_MT_DATA_ACK:
+        if (transaction->position < transaction->writeLength)
         {
-            uint8_t d = recv_buffer[recv_buffer_get_pos++];
-            recv_buffer_len--;
-            if (recv_buffer_get_pos >= RECV_BUFFER_SIZE)
-            {
-                recv_buffer_get_pos = 0;
-            }
-            return d;
+            TWDR = transaction->writeBuffer[transaction->position++];
+            TWCR = TWCR_MASTER;
+        }
+        else if (transaction->readLength > 0)
+        {
+            // switch to reading with a repeated start
+            TWCR = TWCR_MASTER | (1 << TWSTA);
         }
         else
         {
-            return -1;
+            finish(TWIResult::Done, true);
         }
-    }
-    else
-    {
-        if (last)
+        break;
+    case TW_MT_DATA_NACK:
+        // the device may refuse the last byte, anything before is an error
+        if (transaction->position == transaction->writeLength && transaction->readLength == 0)
+            finish(TWIResult::Done, true);
+        else
+            finish(TWIResult::DataNack, true);
+        break;
+    case TW_MT_SLA_NACK:
+    case TW_MR_SLA_NACK:
+        if (transaction->retries < TWI_ADDRESS_RETRIES)
         {
-            isTransfering = false;
+            // device busy, release the bus and address it again
+            transaction->retries++;
+            TWCR = TWCR_MASTER | (1 << TWSTO) | (1 << TWSTA);
         }
-        return i2c_read(!last);
+        else
+        {
+            finish(TWIResult::AddressNack, true);
+        }
+        break;
+    case TW_MR_SLA_ACK:
+        // acknowledge every byte but the last
+        TWCR = TWCR_MASTER | (transaction->readLength > 1 ? (1 << TWEA) : 0);
+        break;
+    case TW_MR_DATA_ACK:
+        transaction->readBuffer[readIndex++] = TWDR;
+        transaction->position++;
+        TWCR = TWCR_MASTER | (readIndex < transaction->readLength - 1 ? (1 << TWEA) : 0);
+        break;
+    case TW_MR_DATA_NACK:
+        transaction->readBuffer[readIndex] = TWDR;
+        transaction->position++;
+        finish(TWIResult::Done, true);
+        break;
+    case TW_MT_ARB_LOST:
+        // the bus belongs to another master, the start of the next transaction waits for it to be free
+        finish(TWIResult::ArbitrationLost, false);
+        break;
+    default:
+        // bus error, a stop condition resets the hardware
+        finish(TWIResult::BusError, true);
+        break;
     }
 }
 
-static int slen(ByteStream *stream)
+ISR(TWI_vect)
 {
     if (isSlave)
     {
-        return recv_buffer_len;
+        I2C_handleInterrupt();
     }
     else
+    {
+        masterInterrupt();
+    }
+}
+
+/// @brief Waits until all queued transactions are finished, so the blocking master functions can use the bus
+static void waitIdle()
+{
+    while (!TWI::isIdle())
+    {
+        TWI::poll();
+    }
+}
+
+int TWIMasterBackend::put(uint8_t data)
+{
+    if (i2c_write(data) == 1)
     {
         return -1;
     }
+    return 1;
+}
+
+int TWIMasterBackend::get(bool last)
+{
+    if (last)
+    {
+        isTransfering = false;
+    }
+    return i2c_read(!last);
+}
+
+int TWIMasterBackend::writeBlock(const uint8_t *data, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (i2c_write(data[i]) == 1)
+        {
+            return i;
+        }
+    }
+    return count;
 }
 
-void TWI::enable()
+int TWIMasterBackend::readBlock(uint8_t *buf, int count, bool last)
+{
+    if (last)
+    {
+        isTransfering = false;
+    }
+    // every byte but the last of the transfer is acknowledged
+    for (int i = 0; i < count - 1; i++)
+    {
+        buf[i] = i2c_readAck();
+    }
+    buf[count - 1] = last ? i2c_readNak() : i2c_readAck();
+    return count;
+}
+
+// ByteStream functions, the backend is picked by the current mode
+static int sput(uint8_t data, ByteStream *stream)
+{
+    return isSlave ? TWISlaveBackend::put(data) : TWIMasterBackend::put(data);
+}
+
+static int sget(ByteStream *stream, bool last)
+{
+    return isSlave ? TWISlaveBackend::get(last) : TWIMasterBackend::get(last);
+}
+
+static int swriteBlock(const uint8_t *data, int count, ByteStream *stream)
+{
+    return isSlave ? TWISlaveBackend::writeBlock(data, count) : TWIMasterBackend::writeBlock(data, count);
+}
+
+static int sreadBlock(ByteStream *stream, uint8_t *buf, int count, bool last)
+{
+    return isSlave ? TWISlaveBackend::readBlock(buf, count, last) : TWIMasterBackend::readBlock(buf, count, last);
+}
+
+static int slen(ByteStream *stream)
+{
+    return isSlave ? TWISlaveBackend::length() : TWIMasterBackend::length();
+}
+
+bool TWI::enable(TWISpeed speed)
 {
     isSlave = false;
     i2c_init();
+    currentSpeed = TWISpeed::Standard;
     sei();
+    return setSpeed(speed);
+}
+
+bool TWI::setSpeed(TWISpeed speed)
+{
+    waitIdle();
+    if (i2c_set_clock((uint32_t)speed) != 0)
+        return false;
+
+    currentSpeed = speed;
+    return true;
+}
+
+TWISpeed TWI::getSpeed()
+{
+    return currentSpeed;
+}
+
+/// @brief Returns the number of devices in the mask that failed any of the probe transactions
+static uint8_t probeDevices(const uint8_t *addresses, uint8_t count, uint8_t *mask)
+{
+    TWITransaction transaction;
+    uint8_t failed = 0;
+
+    for (uint8_t i = 0; i < count && i < 8; i++)
+    {
+        if (!(*mask & (1 << i)))
+            continue;
+
+        for (uint8_t probe = 0; probe < TWI_SELF_TEST_PROBES; probe++)
+        {
+            // an empty write only addresses the device
+            if (!TWI::sendTo(addresses[i], nullptr, 0, &transaction) || TWI::wait(&transaction) != TWIResult::Done)
+            {
+                *mask &= ~(1 << i);
+                failed++;
+                break;
+            }
+        }
+    }
+    return failed;
+}
+
+TWISpeed TWI::selfTest(const uint8_t *addresses, uint8_t count, TWISpeed maxSpeed)
+{
+    static const TWISpeed speeds[] = {TWISpeed::Standard, TWISpeed::Fast, TWISpeed::FastPlus};
+
+    setSpeed(TWISpeed::Standard);
+
+    // only devices present at the standard speed take part
+    uint8_t devices = 0xFF;
+    probeDevices(addresses, count, &devices);
+    if (devices == 0)
+        return TWISpeed::Standard;
+
+    TWISpeed selected = TWISpeed::Standard;
+    for (uint8_t i = 1; i < sizeof(speeds) / sizeof(speeds[0]) && (uint32_t)speeds[i] <= (uint32_t)maxSpeed; i++)
+    {
+        uint8_t mask = devices;
+        if (!setSpeed(speeds[i]) || probeDevices(addresses, count, &mask) > 0)
+            break;
+        selected = speeds[i];
+    }
+
+    setSpeed(selected);
+    return selected;
 }
 
 void TWI::enable(uint8_t address)
 {
     isSlave = true;
-    I2C_setCallbacks(recv, req);
+    I2C_setCallbacks(recv, req, end);
     I2C_init(address);
     sei();
 }
@@ -111,6 +384,7 @@ void TWI::disable()
     }
     else
     {
+        waitIdle();
         TWCR = 0;
         TWBR = 0;
     }
@@ -120,7 +394,9 @@ bool TWI::sendTo(uint8_t address)
 {
     if (!isTransfering)
     {
-        i2c_start_wait((address & 0xFE) + I2C_WRITE);
+        waitIdle();
+        if (i2c_start_wait((address & 0xFE) + I2C_WRITE) != 0)
+            return false;
         isTransfering = true;
         return true;
     }
@@ -134,7 +410,9 @@ bool TWI::requestFrom(uint8_t address)
 {
     if (!isTransfering)
     {
-        i2c_start_wait((address & 0xFE) + I2C_READ);
+        waitIdle();
+        if (i2c_start_wait((address & 0xFE) + I2C_READ) != 0)
+            return false;
         isTransfering = true;
         return true;
     }
@@ -144,6 +422,100 @@ bool TWI::requestFrom(uint8_t address)
     }
 }
 
+bool TWI::submit(TWITransaction *transaction)
+{
+    if (isSlave || isTransfering)
+        return false;
+
+    uint8_t _SREG = SREG;
+    cli();
+
+    if (transaction->result == TWIResult::Pending)
+    {
+        SREG = _SREG;
+        return false;
+    }
+
+    transaction->result = TWIResult::Pending;
+    transaction->next = nullptr;
+    if (queueTail == nullptr)
+    {
+        queueHead = transaction;
+        queueTail = transaction;
+
+        // let a stop condition from the previous transaction complete
+        while (TWCR & (1 << TWSTO))
+            ;
+        startNext(false);
+    }
+    else
+    {
+        queueTail->next = transaction;
+        queueTail = transaction;
+    }
+
+    SREG = _SREG;
+    return true;
+}
+
+bool TWI::sendTo(uint8_t address, uint8_t *data, uint8_t count, TWITransaction *transaction)
+{
+    if (transaction->result == TWIResult::Pending)
+        return false;
+
+    transaction->address = address;
+    transaction->writeBuffer = data;
+    transaction->writeLength = count;
+    transaction->readBuffer = nullptr;
+    transaction->readLength = 0;
+    return submit(transaction);
+}
+
+bool TWI::requestFrom(uint8_t address, uint8_t *buffer, uint8_t count, TWITransaction *transaction)
+{
+    if (transaction->result == TWIResult::Pending)
+        return false;
+
+    transaction->address = address;
+    transaction->writeBuffer = nullptr;
+    transaction->writeLength = 0;
+    transaction->readBuffer = buffer;
+    transaction->readLength = count;
+    return submit(transaction);
+}
+
+void TWI::poll()
+{
+    uint8_t _SREG = SREG;
+    cli();
+    TWITransaction *transaction = queueHead;
+    if (transaction != nullptr && Clock::counter() > transaction->deadline)
+    {
+        // reset the hardware to abort whatever is stuck on the bus
+        TWCR = 0;
+        finish(TWIResult::Timeout, false);
+    }
+    SREG = _SREG;
+}
+
+bool TWI::isIdle()
+{
+    uint8_t _SREG = SREG;
+    cli();
+    bool idle = queueHead == nullptr;
+    SREG = _SREG;
+    return idle;
+}
+
+TWIResult TWI::wait(TWITransaction *transaction)
+{
+    while (transaction->result == TWIResult::Pending)
+    {
+        poll();
+    }
+    return transaction->result;
+}
+
 TWIStatus TWI::getStatus()
 {
     return (TWIStatus)TW_STATUS;
@@ -157,73 +529,133 @@ void TWI::endTransfer()
 
 ByteStream TWI::getStream()
 {
-    return ByteStream(sput, sget, slen);
+    return ByteStream(sput, sget, slen, swriteBlock, sreadBlock);
+}
+
+void TWI::endMessage()
+{
+    uint8_t length = messageLength();
+    if (length == 0)
+        return;
+
+    TWISlaveReceive::buffer.discard(length - TWISlaveReceive::messageRead);
+    TWISlaveReceive::messages.discard(1);
+    TWISlaveReceive::messageRead = 0;
+}
+
+uint16_t TWI::getDroppedBytes()
+{
+    uint8_t _SREG = SREG;
+    cli();
+    uint16_t dropped = recv_dropped;
+    SREG = _SREG;
+    return dropped + TWISlaveReceive::buffer.getOverflows();
 }
 
 bool TWI::isDataRequested()
 {
-    return slaveRequested;
+    bool requested = slaveRequested;
+    slaveRequested = false;
+    return requested;
 }
 
-const char *TWI::nameOfStatus(TWIStatus status)
+bool TWI::publish(const uint8_t *data, uint8_t length)
+{
+    uint8_t back = tx_front ^ 1;
+
+    // the interrupt only latches the front buffer, so the back buffer
+    // is free unless a transfer started before the last publish is still running
+    if (tx_active == back || length > TWI_SLAVE_TX_BUFFER_SIZE)
+        return false;
+
+    memcpy(tx_buffers[back], data, length);
+    tx_length[back] = length;
+    tx_front = back;
+    return true;
+}
+
+PGM_P TWI::nameOfStatus(TWIStatus status)
 {
     switch (status)
     {
     case TWIStatus::Start:
-        return "TW_START";
+        return PSTR("TW_START");
     case TWIStatus::RepStart:
-        return "TW_REP_START";
+        return PSTR("TW_REP_START");
     case TWIStatus::MtSlaAck:
-        return "TW_MT_SLA_ACK";
+        return PSTR("TW_MT_SLA_ACK");
     case TWIStatus::MtSlaNack:
-        return "TW_MT_SLA_NACK";
+        return PSTR("TW_MT_SLA_NACK");
     case TWIStatus::MtDataAck:
-        return "TW_MT_DATA_ACK";
+        return PSTR("TW_MT_DATA_ACK");
     case TWIStatus::MtDataNack:
-        return "TW_MT_DATA_NACK";
+        return PSTR("TW_MT_DATA_NACK");
     case TWIStatus::MtArbLost:
-        return "TW_M*_ARB_LOST";
+        return PSTR("TW_M*_ARB_LOST");
     case TWIStatus::MrSlaAck:
-        return "TW_MR_SLA_ACK";
+        return PSTR("TW_MR_SLA_ACK");
     case TWIStatus::MrSlaNack:
-        return "TW_MR_SLA_NACK";
+        return PSTR("TW_MR_SLA_NACK");
     case TWIStatus::MrDataAck:
-        return "TW_MR_DATA_ACK";
+        return PSTR("TW_MR_DATA_ACK");
     case TWIStatus::MrDataNack:
-        return "TW_MR_DATA_NACK";
+        return PSTR("TW_MR_DATA_NACK");
     case TWIStatus::StSlaAck:
-        return "TW_ST_SLA_ACK";
+        return PSTR("TW_ST_SLA_ACK");
     case TWIStatus::StArbLostSlaAck:
-        return "TW_ST_ARB_LOST_SLA_ACK";
+        return PSTR("TW_ST_ARB_LOST_SLA_ACK");
     case TWIStatus::StDataAck:
-        return "TW_ST_DATA_ACK";
+        return PSTR("TW_ST_DATA_ACK");
     case TWIStatus::StDataNack:
-        return "TW_ST_DATA_NACK";
+        return PSTR("TW_ST_DATA_NACK");
     case TWIStatus::StLastData:
-        return "TW_ST_LAST_DATA";
+        return PSTR("TW_ST_LAST_DATA");
     case TWIStatus::SrSlaAck:
-        return "TW_SR_SLA_ACK";
+        return PSTR("TW_SR_SLA_ACK");
     case TWIStatus::SrArbLostSlaAck:
-        return "TW_SR_ARB_LOST_SLA_ACK";
+        return PSTR("TW_SR_ARB_LOST_SLA_ACK");
     case TWIStatus::SrGcallAck:
-        return "TW_SR_GCALL_ACK";
+        return PSTR("TW_SR_GCALL_ACK");
     case TWIStatus::SrArbLostGcallAck:
-        return "TW_SR_ARB_LOST_GCALL_ACK";
+        return PSTR("TW_SR_ARB_LOST_GCALL_ACK");
     case TWIStatus::SrDataAck:
-        return "TW_SR_DATA_ACK";
+        return PSTR("TW_SR_DATA_ACK");
     case TWIStatus::SrDataNack:
-        return "TW_SR_DATA_NACK";
+        return PSTR("TW_SR_DATA_NACK");
     case TWIStatus::SrGcallDataAck:
-        return "TW_SR_GCALL_DATA_ACK";
+        return PSTR("TW_SR_GCALL_DATA_ACK");
     case TWIStatus::SrGcallDataNack:
-        return "TW_SR_GCALL_DATA_NACK";
+        return PSTR("TW_SR_GCALL_DATA_NACK");
     case TWIStatus::Stop:
-        return "TW_SR_STOP";
+        return PSTR("TW_SR_STOP");
     case TWIStatus::NoInfo:
-        return "TW_NO_INFO";
+        return PSTR("TW_NO_INFO");
     case TWIStatus::BusError:
-        return "TW_BUS_ERROR";
+        return PSTR("TW_BUS_ERROR");
+    default:
+        return PSTR("UNKNOWN");
+    }
+}
+
+PGM_P TWI::nameOfResult(TWIResult result)
+{
+    switch (result)
+    {
+    case TWIResult::Pending:
+        return PSTR("PENDING");
+    case TWIResult::Done:
+        return PSTR("DONE");
+    case TWIResult::AddressNack:
+        return PSTR("ADDRESS_NACK");
+    case TWIResult::DataNack:
+        return PSTR("DATA_NACK");
+    case TWIResult::ArbitrationLost:
+        return PSTR("ARBITRATION_LOST");
+    case TWIResult::BusError:
+        return PSTR("BUS_ERROR");
+    case TWIResult::Timeout:
+        return PSTR("TIMEOUT");
     default:
-        return "UNKNOWN";
+        return PSTR("UNKNOWN");
     }
 }
\ No newline at end of file
@@ -2,6 +2,51 @@
 #define TWI_H
 
 #include "bytestream.h"
+#include "stream.h"
+#include "ringbuffer.h"
+#include "clock.h"
+
+/**
+ * Default time a queued master transaction may take once it is started
+ */
+#ifndef TWI_DEFAULT_TIMEOUT
+#define TWI_DEFAULT_TIMEOUT Time::fromMillis(20)
+#endif
+
+/**
+ * Number of probe transactions per device and speed in TWI::selfTest
+ */
+#ifndef TWI_SELF_TEST_PROBES
+#define TWI_SELF_TEST_PROBES 8
+#endif
+
+/**
+ * Maximum number of bytes published for the master to read in slave mode
+ */
+#ifndef TWI_SLAVE_TX_BUFFER_SIZE
+#define TWI_SLAVE_TX_BUFFER_SIZE 48
+#endif
+
+/**
+ * Size of the receive buffer in slave mode (power of two, at most 256), holds the messages written by the master until they are read
+ */
+#ifndef TWI_SLAVE_RX_BUFFER_SIZE
+#define TWI_SLAVE_RX_BUFFER_SIZE 64
+#endif
+
+/**
+ * Number of message lengths tracked in slave mode (power of two), one less message than this can wait to be read
+ */
+#ifndef TWI_SLAVE_RX_MESSAGES
+#define TWI_SLAVE_RX_MESSAGES 8
+#endif
+
+/**
+ * Number of times a queued master transaction re-addresses a device that does not acknowledge
+ */
+#ifndef TWI_ADDRESS_RETRIES
+#define TWI_ADDRESS_RETRIES 3
+#endif
 
 enum class TWIStatus
 {
@@ -63,33 +108,224 @@ enum class TWIStatus
     BusError = 0x00
 };
 
+/// @brief SCL clock frequencies of the master in Hz
+enum class TWISpeed : uint32_t
+{
+    /// @brief Standard mode, 100 kHz
+    Standard = 100000UL,
+    /// @brief Fast mode, 400 kHz
+    Fast = 400000UL,
+    /// @brief Fast mode plus, 1 MHz (needs F_CPU of at least 36 MHz on the AVR TWI)
+    FastPlus = 1000000UL
+};
+
+/// @brief Result of a queued master transaction
+enum class TWIResult : uint8_t
+{
+    /// @brief Queued or in progress
+    Pending,
+    /// @brief All bytes were transferred
+    Done,
+    /// @brief The device did not acknowledge its address
+    AddressNack,
+    /// @brief The device did not acknowledge a written byte
+    DataNack,
+    /// @brief Another master took the bus
+    ArbitrationLost,
+    /// @brief Illegal start or stop condition on the bus
+    BusError,
+    /// @brief The transaction did not finish in time
+    Timeout
+};
+
+struct TWITransaction;
+
+/// @brief Called when a queued transaction finished
+/// @note Runs inside the TWI interrupt (or TWI::poll() for timeouts), keep it short
+typedef void (*TWICallback)(TWITransaction *transaction);
+
+/// @brief Descriptor of a queued master transaction: an optional write followed by an optional read (with a repeated start).
+/// The descriptor and its buffers are owned by the caller and must stay valid until the result is no longer Pending.
+typedef struct TWITransaction
+{
+    TWITransaction()
+        : address(0), writeBuffer(nullptr), writeLength(0), readBuffer(nullptr), readLength(0),
+          timeout(TWI_DEFAULT_TIMEOUT), callback(nullptr), context(nullptr), result(TWIResult::Done),
+          next(nullptr), position(0), retries(0), deadline(0)
+    {
+    }
+
+    /// @brief Device address (R/W bit is ignored)
+    uint8_t address;
+    uint8_t *writeBuffer;
+    uint8_t writeLength;
+    uint8_t *readBuffer;
+    uint8_t readLength;
+    /// @brief Maximum duration of the transaction once it is started
+    Time timeout;
+    /// @brief Optional completion callback
+    TWICallback callback;
+    /// @brief User pointer for the callback
+    void *context;
+    volatile TWIResult result;
+
+    // managed by the transaction queue
+    TWITransaction *next;
+    uint8_t position;
+    uint8_t retries;
+    ticks_t deadline;
+} TWITransaction;
+
+/// @brief Slave receive state, shared by TWI and TWISlaveBackend
+namespace TWISlaveReceive
+{
+    /// @brief Bytes written by the master
+    extern RingBuffer<uint8_t, TWI_SLAVE_RX_BUFFER_SIZE> buffer;
+    /// @brief Lengths of the complete messages in the buffer, oldest first
+    extern RingBuffer<uint8_t, TWI_SLAVE_RX_MESSAGES> messages;
+    /// @brief Bytes of the oldest message already read
+    extern uint8_t messageRead;
+}
+
 namespace TWI
 {
     /// @brief Enable TWI master interface and interrupts
-    void enable();
+    /// @param speed The SCL clock frequency
+    /// @return Returns false if the speed can not be generated from F_CPU (the bus then runs at the standard speed)
+    bool enable(TWISpeed speed = TWISpeed::Standard);
     /// @brief Enable TWI slave interface and interrupts
     void enable(uint8_t address);
     /// @brief Disable TWI interface and interrupts
     void disable();
 
+    /// @brief Changes the SCL clock frequency of the master, waits for queued transactions first
+    /// @return Returns false if the speed can not be generated from F_CPU (the speed is unchanged)
+    bool setSpeed(TWISpeed speed);
+    /// @brief Returns the current SCL clock frequency of the master
+    TWISpeed getSpeed();
+    /// @brief Steps the bus speed up until transfers to the devices start failing, then falls back to the last good speed.
+    /// Devices that do not answer at the standard speed are left out of the test.
+    /// @param addresses The devices to probe
+    /// @param count Number of devices
+    /// @param maxSpeed The highest speed to try
+    /// @return Returns the selected speed
+    TWISpeed selfTest(const uint8_t *addresses, uint8_t count, TWISpeed maxSpeed);
+
     /// @brief Sends SLA+W request as master to the specified address
+    /// @note Blocks until queued transactions are finished
     bool sendTo(uint8_t address);
     /// @brief Sends SLA+R request as master to the specified address
+    /// @note Blocks until queued transactions are finished
     bool requestFrom(uint8_t address);
     /// @brief Ends current transfer of data in master mode (SLA+R/SLA+W)
     void endTransfer();
 
+    /// @brief Queues a master transaction, it is run by the TWI interrupt
+    /// @return Returns false if not in master mode or the transaction is already queued
+    bool submit(TWITransaction *transaction);
+    /// @brief Queues a write of count bytes to the specified address (keeps the callback and timeout of the transaction)
+    bool sendTo(uint8_t address, uint8_t *data, uint8_t count, TWITransaction *transaction);
+    /// @brief Queues a read of count bytes from the specified address (keeps the callback and timeout of the transaction)
+    bool requestFrom(uint8_t address, uint8_t *buffer, uint8_t count, TWITransaction *transaction);
+    /// @brief Aborts the running transaction if it timed out, call regularly from the main loop
+    void poll();
+    /// @brief Returns true if no transaction is queued or running
+    bool isIdle();
+    /// @brief Polls until the transaction is finished
+    /// @return Returns the result of the transaction
+    TWIResult wait(TWITransaction *transaction);
+
     /// @brief Returns current status
     /// @return The current status
     TWIStatus getStatus();
 
-    /// @brief Returns the i2c ByteStream
+    /// @brief Returns the i2c ByteStream, it switches between the master and slave backend at runtime
+    /// @note In slave mode the stream only reads the oldest complete message, call endMessage() to move on to the next one
     ByteStream getStream();
 
-    /// @brief Returns true if master is requesting data
+    /// @brief Returns the length of the oldest message written by the master that ended with a stop condition,
+    /// 0 if there is none (slave mode)
+    inline uint8_t messageLength()
+    {
+        uint8_t length;
+        return TWISlaveReceive::messages.peek(&length) ? length : 0;
+    }
+    /// @brief Drops the unread rest of the oldest message, the stream then reads the next one (slave mode)
+    void endMessage();
+    /// @brief Returns the number of received bytes dropped because the receive buffer was full (slave mode)
+    uint16_t getDroppedBytes();
+
+    /// @brief Returns true if the master read data since the last call
     bool isDataRequested();
 
-    const char *nameOfStatus(TWIStatus status);
+    /// @brief Publishes the bytes sent when the master reads (slave mode).
+    /// The data is copied into a double buffer and served by the TWI interrupt, the master reads the latest published copy.
+    /// @note Call from one context only (e.g. a control loop task)
+    /// @return Returns false if the buffer to fill is still being sent (try again on the next publish) or the data is too long
+    bool publish(const uint8_t *data, uint8_t length);
+
+    /// @brief Returns the name of a status in program memory (print with %S)
+    PGM_P nameOfStatus(TWIStatus status);
+    /// @brief Returns the name of a result in program memory (print with %S)
+    PGM_P nameOfResult(TWIResult result);
 }
 
+/// @brief Stream backend reading the oldest message written by the master in slave mode
+struct TWISlaveBackend
+{
+    /// @brief Writing is not supported, the master reads the data published with TWI::publish
+    static inline int put(uint8_t data)
+    {
+        return -1;
+    }
+
+    static inline int get(bool last)
+    {
+        uint8_t d;
+        if (TWISlaveReceive::messageRead < TWI::messageLength() && TWISlaveReceive::buffer.pop(&d))
+        {
+            TWISlaveReceive::messageRead++;
+            return d;
+        }
+        return -1;
+    }
+
+    static inline int length()
+    {
+        return TWI::messageLength() - TWISlaveReceive::messageRead;
+    }
+
+    static inline int writeBlock(const uint8_t *data, int count)
+    {
+        return -1;
+    }
+
+    static inline int readBlock(uint8_t *buf, int count, bool last)
+    {
+        uint8_t rest = length();
+        uint8_t c = TWISlaveReceive::buffer.pop(buf, count < rest ? count : rest);
+        TWISlaveReceive::messageRead += c;
+        return c;
+    }
+};
+
+/// @brief Stream backend for the blocking master transfers started with TWI::sendTo and TWI::requestFrom
+struct TWIMasterBackend
+{
+    static int put(uint8_t data);
+    static int get(bool last);
+    /// @brief The length of a master transfer is unknown
+    static inline int length()
+    {
+        return -1;
+    }
+    static int writeBlock(const uint8_t *data, int count);
+    static int readBlock(uint8_t *buf, int count, bool last);
+};
+
+/// @brief Slave stream with inlined byte access (see TWISlaveBackend)
+typedef Stream<TWISlaveBackend> TWISlaveStream;
+/// @brief Master stream for blocking transfers (see TWIMasterBackend)
+typedef Stream<TWIMasterBackend> TWIMasterStream;
+
 #endif
\ No newline at end of file
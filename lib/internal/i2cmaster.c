@@ -19,18 +19,54 @@
 /* I2C clock in Hz */
 #define SCL_CLOCK 100000L
 
+/* lowest TWBR value for stable operation in master mode */
+#define TWBR_MIN 10
+
+/* number of times i2c_start_wait addresses a busy device before giving up */
+#ifndef I2C_START_WAIT_RETRIES
+#define I2C_START_WAIT_RETRIES 10
+#endif
+
 /*************************************************************************
  Initialization of the I2C bus interface. Need to be called only once
 *************************************************************************/
 void i2c_init(void)
 {
-    /* initialize TWI clock: 100 kHz clock, TWPS = 0 => prescaler = 1 */
-
-    TWSR = 0;                              /* no prescaler */
-    TWBR = ((F_CPU / SCL_CLOCK) - 16) / 2; /* must be > 10 for stable operation */
+    /* initialize TWI clock: 100 kHz clock */
+    i2c_set_clock(SCL_CLOCK);
 
 } /* i2c_init */
 
+/*************************************************************************
+ Sets the SCL clock: SCL = F_CPU / (16 + 2 * TWBR * 4^TWPS)
+ Return:  0 clock set
+          1 frequency not possible with F_CPU
+*************************************************************************/
+unsigned char i2c_set_clock(unsigned long scl)
+{
+    unsigned long divider;
+    uint8_t twps;
+
+    if (scl == 0 || F_CPU / scl < 16 + 2 * TWBR_MIN)
+        return 1;
+
+    /* use the smallest prescaler that fits TWBR into 8 bits */
+    divider = (F_CPU / scl - 16) / 2;
+    for (twps = 0; twps < 4; twps++)
+    {
+        if (divider <= 255)
+        {
+            TWSR = twps; /* prescaler bits TWPS1:0 */
+            TWBR = (uint8_t)divider;
+            return 0;
+        }
+        divider /= 4;
+    }
+
+    return 1;
+
+} /* i2c_set_clock */
+
 /*************************************************************************
   Issues a start condition and sends address and transfer direction.
   return 0 = device accessible, 1= failed to access device
@@ -73,13 +109,20 @@ unsigned char i2c_start(unsigned char address)
  If device is busy, use ack polling to wait until device is ready
 
  Input:   address and transfer direction of I2C device
+
+ Return:  0 device accessible
+          1 failed to access device after I2C_START_WAIT_RETRIES attempts
 *************************************************************************/
-void i2c_start_wait(unsigned char address)
+unsigned char i2c_start_wait(unsigned char address)
 {
     uint8_t twst;
+    uint8_t retries = 0;
 
     while (1)
     {
+        if (retries++ >= I2C_START_WAIT_RETRIES)
+            return 1;
+
         // send START condition
         TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
 
@@ -117,6 +160,8 @@ void i2c_start_wait(unsigned char address)
         break;
     }
 
+    return 0;
+
 } /* i2c_start_wait */
 
 /*************************************************************************
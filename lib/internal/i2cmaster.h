@@ -100,6 +100,14 @@
  */
 void i2c_init(void);
 
+/**
+ @brief Sets the SCL clock frequency, choosing the TWI prescaler needed for F_CPU
+ @param    scl SCL frequency in Hz
+ @retval   0 clock set
+ @retval   1 frequency can not be generated from F_CPU (clock unchanged)
+ */
+unsigned char i2c_set_clock(unsigned long scl);
+
 /**
  @brief Terminates the data transfer and releases the I2C bus
  @param void
@@ -128,11 +136,12 @@ unsigned char i2c_rep_start(unsigned char addr);
 /**
  @brief Issues a start condition and sends address and transfer direction
 
- If device is busy, use ack polling to wait until device ready
+ If device is busy, use ack polling to wait until device ready (at most I2C_START_WAIT_RETRIES attempts)
  @param    addr address and transfer direction of I2C device
- @return   none
+ @retval   0 device accessible
+ @retval   1 failed to access device
  */
-void i2c_start_wait(unsigned char addr);
+unsigned char i2c_start_wait(unsigned char addr);
 
 /**
  @brief Send one byte to I2C device
@@ -4,12 +4,14 @@
 #include "i2cslave.h"
 
 static void (*I2C_recv)(uint8_t);
-static void (*I2C_req)();
+static uint8_t (*I2C_req)(uint8_t);
+static void (*I2C_end)();
 
-void I2C_setCallbacks(void (*recv)(uint8_t), void (*req)())
+void I2C_setCallbacks(void (*recv)(uint8_t), uint8_t (*req)(uint8_t first), void (*end)())
 {
     I2C_recv = recv;
     I2C_req = req;
+    I2C_end = end;
 }
 
 void I2C_init(uint8_t address)
@@ -31,7 +33,7 @@ void I2C_stop(void)
     sei();
 }
 
-ISR(TWI_vect)
+void I2C_handleInterrupt(void)
 {
     switch (TW_STATUS)
     {
@@ -41,13 +43,20 @@ ISR(TWI_vect)
         TWCR = (1 << TWIE) | (1 << TWINT) | (1 << TWEA) | (1 << TWEN);
         break;
     case TW_ST_SLA_ACK:
-        // master is requesting data, call the request callback
-        I2C_req();
+        // master starts reading, load the first byte before releasing the clock
+        TWDR = I2C_req(1);
         TWCR = (1 << TWIE) | (1 << TWINT) | (1 << TWEA) | (1 << TWEN);
         break;
     case TW_ST_DATA_ACK:
-        // master is requesting data, call the request callback
-        I2C_req();
+        // master wants the next byte
+        TWDR = I2C_req(0);
+        TWCR = (1 << TWIE) | (1 << TWINT) | (1 << TWEA) | (1 << TWEN);
+        break;
+    case TW_ST_DATA_NACK:
+    case TW_ST_LAST_DATA:
+    case TW_SR_STOP:
+        // transfer finished
+        I2C_end();
         TWCR = (1 << TWIE) | (1 << TWINT) | (1 << TWEA) | (1 << TWEN);
         break;
     case TW_BUS_ERROR:
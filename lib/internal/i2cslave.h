@@ -6,13 +6,17 @@
 
 void I2C_init(uint8_t address);
 void I2C_stop(void);
-void I2C_setCallbacks(void (*recv)(uint8_t), void (*req)());
+/// @param recv Called with every byte received from the master
+/// @param req Returns the byte to send to the master, first is set on the first byte of a read
+/// @param end Called when the master ends a transfer (stop condition or last byte read)
+void I2C_setCallbacks(void (*recv)(uint8_t), uint8_t (*req)(uint8_t first), void (*end)());
 
 inline void __attribute__((always_inline)) I2C_transmitByte(uint8_t data)
 {
     TWDR = data;
 }
 
-ISR(TWI_vect);
+/// @brief Handles the TWI interrupt in slave mode (called by the TWI_vect handler in i2c.cpp)
+void I2C_handleInterrupt(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <stdint.h>
+
+// Wire format of the binary debug log, shared by the firmware and the host decoder.
+//
+// Frame: [sync][length][level][id lo][id hi][timestamp (4, ms, little endian)][arguments...][checksum]
+// length counts the bytes between itself and the checksum, the checksum makes the
+// 8-bit sum of every byte after the sync byte (length and checksum included) zero.
+//
+// Arguments are the raw little endian bytes of each printf argument after default
+// promotion (int is 2 bytes, long 4, float 4), strings are sent NUL-terminated.
+
+/// @brief First byte of every binary log frame (never part of the ASCII text output)
+#define LOG_FRAME_SYNC 0xA5
+/// @brief Number of bytes counted by the length field before the arguments
+#define LOG_FRAME_HEADER_SIZE 7
+
+/**
+ * Maximum number of argument bytes in one binary log frame, longer arguments are truncated
+ */
+#ifndef LOG_MAX_ARGS_SIZE
+#define LOG_MAX_ARGS_SIZE 32
+#endif
+
+enum class LogLevel : uint8_t
+{
+    Info,
+    Warn,
+    Error
+};
+
+/// @brief 32-bit FNV-1a hash of a string
+constexpr uint32_t logHash(const char *str, uint32_t hash = 2166136261UL)
+{
+    return *str == 0 ? hash : logHash(str + 1, (hash ^ (uint8_t)*str) * 16777619UL);
+}
+
+/// @brief Returns the ID of a format string (FNV-1a folded to 16 bits)
+/// @note autogen.py computes the same ID for the string table, keep both in sync
+constexpr uint16_t logId(const char *fmt)
+{
+    return (uint16_t)((logHash(fmt) >> 16) ^ (logHash(fmt) & 0xFFFF));
+}
+
+#endif
\ No newline at end of file
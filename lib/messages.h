@@ -0,0 +1,64 @@
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include "schema.h"
+
+/// @brief Size of the largest drivetrain command, including the id
+#define DRIVETRAIN_MAX_COMMAND_SIZE 9
+
+// Data of the drivetrain commands, packed so the fields of the schema below follow each other
+
+typedef struct __attribute__((packed)) DriveCommandData
+{
+    uint8_t direction;
+} DriveCommandData;
+
+typedef struct __attribute__((packed)) TurnCommandData
+{
+    float angle;
+} TurnCommandData;
+
+typedef struct __attribute__((packed)) SetVelocityCommandData
+{
+    float leftVelocity;
+    float rightVelocity;
+} SetVelocityCommandData;
+
+typedef struct __attribute__((packed)) SetTurnVelocityCommandData
+{
+    float velocity;
+} SetTurnVelocityCommandData;
+
+typedef struct __attribute__((packed)) MoveCommandData
+{
+    float distance;
+} MoveCommandData;
+
+typedef struct __attribute__((packed)) SetPIDGainCommandData
+{
+    uint8_t wheels;
+    uint8_t gain;
+    float value;
+} SetPIDGainCommandData;
+
+typedef struct __attribute__((packed)) SetEncodingCommandData
+{
+    uint8_t encoding;
+} SetEncodingCommandData;
+
+// Wire format of the drivetrain commands, the only place it is written down
+
+typedef MessageDef<CMD_DRIVETRAIN_DRIVE, DriveCommandData, ByteField> DriveMessage;
+typedef MessageDef<CMD_DRIVETRAIN_STOP, NoData> StopMessage;
+typedef MessageDef<CMD_DRIVETRAIN_TURN, TurnCommandData, AngleField> TurnMessage;
+typedef MessageDef<CMD_DRIVETRAIN_SET_VELOCITY, SetVelocityCommandData, ScaledField<SpeedScale>, ScaledField<SpeedScale>> SetVelocityMessage;
+typedef MessageDef<CMD_DRIVETRAIN_SET_TURN_VELOCITY, SetTurnVelocityCommandData, ScaledField<SpeedScale>> SetTurnVelocityMessage;
+typedef MessageDef<CMD_DRIVETRAIN_MOVE, MoveCommandData, ScaledField<DistanceScale>> MoveMessage;
+typedef MessageDef<CMD_DRIVETRAIN_SET_PID_GAIN, SetPIDGainCommandData, ByteField, ByteField, FloatField> SetPIDGainMessage;
+typedef MessageDef<CMD_DRIVETRAIN_SET_ENCODING, SetEncodingCommandData, ByteField> SetEncodingMessage;
+
+static_assert(maxMessageSize<DriveMessage, StopMessage, TurnMessage, SetVelocityMessage, SetTurnVelocityMessage,
+                             MoveMessage, SetPIDGainMessage, SetEncodingMessage>() <= DRIVETRAIN_MAX_COMMAND_SIZE,
+              "DRIVETRAIN_MAX_COMMAND_SIZE is too small for a drivetrain command");
+
+#endif
\ No newline at end of file
@@ -30,4 +30,14 @@ void Motor::stop()
 {
     io.put(pin1, BRAKE_MODE);
     io.put(pin2, BRAKE_MODE);
+}
+
+uint8_t Motor::getPin1()
+{
+    return pin1;
+}
+
+uint8_t Motor::getPin2()
+{
+    return pin2;
 }
\ No newline at end of file
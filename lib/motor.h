@@ -22,6 +22,12 @@ public:
     /// @brief Stops the motor
     void stop();
 
+    /// @brief Returns the first pin of the motor
+    uint8_t getPin1();
+
+    /// @brief Returns the second pin of the motor
+    uint8_t getPin2();
+
 private:
     uint8_t pin1;
     uint8_t pin2;
@@ -0,0 +1,119 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include "framework.h"
+
+/// @brief Usage of an ObjectPool
+typedef struct ObjectPoolStats
+{
+    /// @brief Number of items currently acquired
+    uint8_t used;
+    /// @brief Highest number of items acquired at the same time
+    uint8_t highWaterMark;
+    /// @brief Number of acquires that failed because the pool was empty
+    uint16_t failures;
+} ObjectPoolStats;
+
+/// @brief Fixed number of items handed out and returned in constant time, without heap allocations
+/// @tparam T The item type, items are neither constructed nor cleared on acquire
+/// @tparam N Number of items in the pool
+/// @note Safe to use from interrupts
+template <typename T, uint8_t N>
+struct ObjectPool
+{
+    static_assert(N > 0 && N < 0xFF, "ObjectPool holds 1 to 254 items");
+
+    ObjectPool()
+    {
+        // every free item links to the next free one, N ends the list
+        for (uint8_t i = 0; i < N; i++)
+        {
+            next[i] = i + 1;
+        }
+        freeHead = 0;
+        stats = {};
+    }
+
+    /// @brief Takes an item out of the pool
+    /// @return Returns the item or nullptr if all items are in use
+    T *acquire()
+    {
+        uint8_t _SREG = SREG;
+        cli();
+        if (freeHead == N)
+        {
+            stats.failures++;
+            SREG = _SREG;
+            return nullptr;
+        }
+
+        uint8_t index = freeHead;
+        freeHead = next[index];
+        if (++stats.used > stats.highWaterMark)
+        {
+            stats.highWaterMark = stats.used;
+        }
+        SREG = _SREG;
+        return &items[index];
+    }
+
+    /// @brief Returns an item to the pool
+    /// @param item An item from acquire() or nullptr
+    void release(T *item)
+    {
+        if (item == nullptr)
+            return;
+
+        uint8_t index = item - items;
+        uint8_t _SREG = SREG;
+        cli();
+        next[index] = freeHead;
+        freeHead = index;
+        stats.used--;
+        SREG = _SREG;
+    }
+
+    /// @brief Returns the number of items that can still be acquired
+    uint8_t available()
+    {
+        uint8_t _SREG = SREG;
+        cli();
+        uint8_t count = N - stats.used;
+        SREG = _SREG;
+        return count;
+    }
+
+    /// @brief Returns the total number of items in the pool
+    constexpr uint8_t capacity() const
+    {
+        return N;
+    }
+
+    ObjectPoolStats getStats()
+    {
+        uint8_t _SREG = SREG;
+        cli();
+        ObjectPoolStats copy = stats;
+        SREG = _SREG;
+        return copy;
+    }
+
+    /// @brief Clears the high water mark and failure count
+    void resetStats()
+    {
+        uint8_t _SREG = SREG;
+        cli();
+        stats.highWaterMark = stats.used;
+        stats.failures = 0;
+        SREG = _SREG;
+    }
+
+private:
+    T items[N];
+    /// @brief Index of the next free item for every free item
+    uint8_t next[N];
+    uint8_t freeHead;
+    ObjectPoolStats stats;
+};
+
+#endif
\ No newline at end of file
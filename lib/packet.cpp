@@ -0,0 +1,165 @@
+#include "packet.h"
+#include "serialize.h"
+#include <string.h>
+
+PacketLink::PacketLink() : PacketLink(ByteStream())
+{
+}
+
+PacketLink::PacketLink(ByteStream stream)
+{
+    this->stream = stream;
+    stats = {};
+    txSequence = 0;
+    rxLength = 0;
+    rxRemaining = 0;
+    rxPendingZero = false;
+    rxOverflow = false;
+    hasPacket = false;
+}
+
+bool PacketLink::send(uint8_t type, const uint8_t *payload, uint8_t length)
+{
+    return send(type, ++txSequence, payload, length);
+}
+
+bool PacketLink::send(uint8_t type, uint8_t sequence, const uint8_t *payload, uint8_t length)
+{
+    if (length > PACKET_MAX_PAYLOAD)
+        return false;
+
+    // the packet is built one byte in, so it can be COBS encoded in place
+    uint8_t *raw = txFrame + 1;
+    raw[0] = type;
+    raw[1] = sequence;
+    raw[2] = length;
+    memcpy(raw + PACKET_HEADER_SIZE, payload, length);
+    uint8_t size = PACKET_HEADER_SIZE + length;
+    encodeInt16(raw + size, crc16(raw, size));
+    size += PACKET_CRC_SIZE;
+
+    // every 0x00 is replaced by the distance to the next one, the code byte in front holds the first distance
+    uint8_t code = 0;
+    for (uint8_t i = 1; i <= size; i++)
+    {
+        if (txFrame[i] == 0)
+        {
+            txFrame[code] = i - code;
+            code = i;
+        }
+    }
+    txFrame[code] = size + 1 - code;
+    txFrame[size + 1] = PACKET_DELIMITER;
+
+    int frameSize = size + 2;
+    if (stream.write(txFrame, 0, frameSize) != frameSize)
+        return false;
+
+    stats.sent++;
+    return true;
+}
+
+const Packet *PacketLink::receive()
+{
+    if (hasPacket)
+        return &packet;
+
+    while (stream.length() > 0)
+    {
+        int data = stream.read();
+        if (data < 0)
+            break;
+
+        if (decode(data))
+        {
+            hasPacket = true;
+            stats.received++;
+            return &packet;
+        }
+    }
+    return nullptr;
+}
+
+void PacketLink::release()
+{
+    hasPacket = false;
+}
+
+bool PacketLink::decode(uint8_t data)
+{
+    if (data == PACKET_DELIMITER)
+    {
+        bool complete = !rxOverflow && rxRemaining == 0 && rxLength > 0;
+        bool valid = complete && validate();
+        if (!complete && (rxOverflow || rxRemaining != 0))
+            stats.framingErrors++;
+
+        rxLength = 0;
+        rxRemaining = 0;
+        rxPendingZero = false;
+        rxOverflow = false;
+        return valid;
+    }
+
+    if (rxOverflow)
+        return false;
+
+    if (rxRemaining == 0)
+    {
+        // code byte, the previous block ended with a 0x00 unless it was the first
+        if (rxPendingZero)
+        {
+            if (rxLength == PACKET_MAX_SIZE)
+            {
+                rxOverflow = true;
+                return false;
+            }
+            rxFrame[rxLength++] = 0;
+        }
+        rxRemaining = data - 1;
+        rxPendingZero = data != 0xFF;
+        return false;
+    }
+
+    if (rxLength == PACKET_MAX_SIZE)
+    {
+        rxOverflow = true;
+        return false;
+    }
+    rxFrame[rxLength++] = data;
+    rxRemaining--;
+    return false;
+}
+
+bool PacketLink::validate()
+{
+    if (rxLength < PACKET_HEADER_SIZE + PACKET_CRC_SIZE ||
+        rxFrame[2] != rxLength - PACKET_HEADER_SIZE - PACKET_CRC_SIZE)
+    {
+        stats.framingErrors++;
+        return false;
+    }
+
+    uint8_t size = rxLength - PACKET_CRC_SIZE;
+    if ((uint16_t)decodeInt16(rxFrame + size) != crc16(rxFrame, size))
+    {
+        stats.crcErrors++;
+        return false;
+    }
+
+    packet.type = rxFrame[0];
+    packet.sequence = rxFrame[1];
+    packet.length = rxFrame[2];
+    packet.payload = rxFrame + PACKET_HEADER_SIZE;
+    return true;
+}
+
+PacketStats PacketLink::getStats()
+{
+    return stats;
+}
+
+void PacketLink::resetStats()
+{
+    stats = {};
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef PACKET_H
+#define PACKET_H
+
+#include "framework.h"
+#include "bytestream.h"
+#include "constants.h"
+#include "wireformat.h"
+
+// Packets on a byte stream (the radio link), the framing is described in wireformat.h
+
+static_assert(PACKET_MAX_SIZE < 0xFF, "Packets must fit into a single COBS block");
+
+/// @brief A received packet, the payload points into the receive buffer of the link
+typedef struct Packet
+{
+    uint8_t type;
+    uint8_t sequence;
+    uint8_t length;
+    const uint8_t *payload;
+} Packet;
+
+/// @brief Statistics of a packet link
+typedef struct PacketStats
+{
+    /// @brief Packets sent
+    uint16_t sent;
+    /// @brief Valid packets received
+    uint16_t received;
+    /// @brief Frames dropped because of a wrong checksum
+    uint16_t crcErrors;
+    /// @brief Frames dropped because they were truncated, too long or had a wrong length
+    uint16_t framingErrors;
+} PacketStats;
+
+/// @brief Sends and receives packets framed with COBS and protected by a CRC-16 over a ByteStream
+typedef struct PacketLink
+{
+public:
+    /// @brief Creates a closed link, assign a link with a stream before use
+    PacketLink();
+    PacketLink(ByteStream stream);
+
+    /// @brief Sends a packet with the next sequence number
+    /// @return Returns false if the payload is too long or the stream did not take the frame
+    bool send(uint8_t type, const uint8_t *payload, uint8_t length);
+
+    /// @brief Sends a packet with the given sequence number (retransmits)
+    /// @return Returns false if the payload is too long or the stream did not take the frame
+    bool send(uint8_t type, uint8_t sequence, const uint8_t *payload, uint8_t length);
+
+    /// @brief Returns the sequence number of the last packet sent with send(type, payload, length)
+    inline uint8_t getLastSequence()
+    {
+        return txSequence;
+    }
+
+    /// @brief Reads the bytes waiting on the stream until a valid packet is complete
+    /// @return Returns the packet or nullptr if there is none yet.
+    /// The packet stays valid and is returned again until release() is called, the stream is not read meanwhile.
+    const Packet *receive();
+
+    /// @brief Frees the packet returned by receive() so the next one can be received
+    void release();
+
+    PacketStats getStats();
+    void resetStats();
+
+private:
+    /// @brief Decodes a received byte
+    /// @return Returns true if a valid packet is complete
+    bool decode(uint8_t data);
+    /// @brief Checks the decoded frame and fills in the packet
+    bool validate();
+
+    ByteStream stream;
+    PacketStats stats;
+
+    uint8_t txSequence;
+    uint8_t txFrame[PACKET_MAX_FRAME_SIZE];
+
+    uint8_t rxFrame[PACKET_MAX_SIZE];
+    uint8_t rxLength;
+    /* bytes left in the current COBS block, 0 if the next byte is a code byte */
+    uint8_t rxRemaining;
+    /* the current COBS block ends with an implicit 0x00 */
+    bool rxPendingZero;
+    /* the frame is too long and is skipped until the next delimiter */
+    bool rxOverflow;
+
+    bool hasPacket;
+    Packet packet;
+} PacketLink;
+
+#endif
\ No newline at end of file
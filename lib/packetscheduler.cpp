@@ -0,0 +1,171 @@
+#include "packetscheduler.h"
+#include "clock.h"
+#include <string.h>
+
+/* the packet uses the sequence number stored in the queue */
+#define QUEUED_HAS_SEQUENCE 0x01
+/* a pointer to the payload is queued instead of the payload */
+#define QUEUED_BY_REFERENCE 0x02
+
+PacketScheduler::PacketScheduler(PacketLink *link)
+{
+    this->link = link;
+    for (uint8_t p = 0; p < PACKET_PRIORITY_COUNT; p++)
+    {
+        stats[p] = {};
+    }
+}
+
+bool PacketScheduler::send(PacketPriority priority, uint8_t type, const uint8_t *payload, uint8_t length)
+{
+    return queue(priority, type, 0, 0, payload, length);
+}
+
+bool PacketScheduler::send(PacketPriority priority, uint8_t type, uint8_t sequence, const uint8_t *payload, uint8_t length)
+{
+    return queue(priority, type, sequence, QUEUED_HAS_SEQUENCE, payload, length);
+}
+
+bool PacketScheduler::sendByReference(PacketPriority priority, uint8_t type, uint8_t sequence, const uint8_t *payload, uint8_t length)
+{
+    return queue(priority, type, sequence, QUEUED_HAS_SEQUENCE | QUEUED_BY_REFERENCE, payload, length);
+}
+
+/* appends a packet to a queue of any size, returns false if it does not fit */
+template <uint16_t N>
+static bool pushPacket(RingBuffer<uint8_t, N> *queue, uint8_t type, uint8_t sequence, uint8_t flags, const uint8_t *payload, uint8_t length)
+{
+    uint8_t size = (flags & QUEUED_BY_REFERENCE) ? PACKET_QUEUE_REFERENCE_SIZE : PACKET_QUEUE_HEADER_SIZE + length;
+    if (queue->space() < size)
+        return false;
+
+    uint16_t now = Clock::stamp();
+    queue->push(length);
+    queue->push(type);
+    queue->push(sequence);
+    queue->push(flags);
+    queue->push(now & 0xFF);
+    queue->push(now >> 8);
+    if (flags & QUEUED_BY_REFERENCE)
+    {
+        uint8_t pointer[sizeof(payload)];
+        memcpy(pointer, &payload, sizeof(payload));
+        for (uint8_t i = 0; i < sizeof(pointer); i++)
+        {
+            queue->push(pointer[i]);
+        }
+    }
+    else
+    {
+        for (uint8_t i = 0; i < length; i++)
+        {
+            queue->push(payload[i]);
+        }
+    }
+    return true;
+}
+
+bool PacketScheduler::queue(PacketPriority priority, uint8_t type, uint8_t sequence, uint8_t flags, const uint8_t *payload, uint8_t length)
+{
+    PacketClassStats *classStats = &stats[(uint8_t)priority];
+    bool queued = false;
+    if (length <= PACKET_MAX_PAYLOAD)
+    {
+        switch (priority)
+        {
+        case PacketPriority::Control:
+            queued = pushPacket(&controlQueue, type, sequence, flags, payload, length);
+            break;
+        case PacketPriority::Command:
+            queued = pushPacket(&commandQueue, type, sequence, flags, payload, length);
+            break;
+        case PacketPriority::Bulk:
+            queued = pushPacket(&bulkQueue, type, sequence, flags, payload, length);
+            break;
+        }
+    }
+    if (!queued)
+    {
+        classStats->dropped++;
+        return false;
+    }
+
+    if (++classStats->depth > classStats->maxDepth)
+        classStats->maxDepth = classStats->depth;
+    return true;
+}
+
+template <uint16_t N>
+void PacketScheduler::sendNext(RingBuffer<uint8_t, N> *queue, PacketClassStats *classStats)
+{
+    uint8_t header[PACKET_QUEUE_HEADER_SIZE];
+    uint8_t buffer[PACKET_MAX_PAYLOAD];
+    const uint8_t *payload = buffer;
+    queue->pop(header, PACKET_QUEUE_HEADER_SIZE);
+    uint8_t length = header[0];
+    if (header[3] & QUEUED_BY_REFERENCE)
+    {
+        queue->pop(buffer, sizeof(payload));
+        memcpy(&payload, buffer, sizeof(payload));
+    }
+    else
+    {
+        queue->pop(buffer, length);
+    }
+
+    classStats->depth--;
+
+    bool sent = (header[3] & QUEUED_HAS_SEQUENCE) ? link->send(header[1], header[2], payload, length)
+                                                  : link->send(header[1], payload, length);
+    if (!sent)
+    {
+        classStats->dropped++;
+        return;
+    }
+
+    // the waiting time in clock stamps wraps with the 16 bit timestamp, fine for waits below a minute
+    uint16_t latency = Clock::stamp() - (header[4] | (header[5] << 8));
+    classStats->sent++;
+    classStats->totalLatency += latency;
+    if (latency > classStats->maxLatency)
+        classStats->maxLatency = latency;
+}
+
+bool PacketScheduler::poll()
+{
+    if (!controlQueue.isEmpty())
+        sendNext(&controlQueue, &stats[(uint8_t)PacketPriority::Control]);
+    else if (!commandQueue.isEmpty())
+        sendNext(&commandQueue, &stats[(uint8_t)PacketPriority::Command]);
+    else if (!bulkQueue.isEmpty())
+        sendNext(&bulkQueue, &stats[(uint8_t)PacketPriority::Bulk]);
+    else
+        return false;
+    return true;
+}
+
+bool PacketScheduler::isIdle()
+{
+    return controlQueue.isEmpty() && commandQueue.isEmpty() && bulkQueue.isEmpty();
+}
+
+PacketClassStats PacketScheduler::getStats(PacketPriority priority)
+{
+    // the waiting times are kept in clock stamps, converted only here
+    PacketClassStats classStats = stats[(uint8_t)priority];
+    ticks_t maxLatency = Clock::stampsToMillis(classStats.maxLatency);
+    classStats.maxLatency = maxLatency > UINT16_MAX ? UINT16_MAX : (uint16_t)maxLatency;
+    classStats.totalLatency = (uint32_t)Clock::stampsToMillis(classStats.totalLatency);
+    return classStats;
+}
+
+void PacketScheduler::resetStats()
+{
+    for (uint8_t p = 0; p < PACKET_PRIORITY_COUNT; p++)
+    {
+        uint8_t depth = stats[p].depth;
+        stats[p] = {};
+        stats[p].depth = depth;
+        stats[p].maxDepth = depth;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#ifndef PACKET_SCHEDULER_H
+#define PACKET_SCHEDULER_H
+
+#include "framework.h"
+#include "packet.h"
+#include "ringbuffer.h"
+
+// Bytes queued per priority class (powers of two), a queued packet takes its payload and PACKET_QUEUE_HEADER_SIZE
+
+#ifndef PACKET_CONTROL_QUEUE_SIZE
+/** Queue of the control class, sized for a few acknowledgements and stop commands */
+#define PACKET_CONTROL_QUEUE_SIZE 32
+#endif
+
+#ifndef PACKET_COMMAND_QUEUE_SIZE
+/** Queue of the command class, sized for the reliable window queued by reference (see reliablelink.h) */
+#define PACKET_COMMAND_QUEUE_SIZE 32
+#endif
+
+#ifndef PACKET_BULK_QUEUE_SIZE
+/** Queue of the bulk class, sized for one telemetry packet of the largest size */
+#define PACKET_BULK_QUEUE_SIZE 64
+#endif
+
+/// @brief Bytes stored in front of the payload of a queued packet: [length][type][sequence][flags][queued at (2 bytes, Clock::stamp())]
+#define PACKET_QUEUE_HEADER_SIZE 6
+/// @brief Bytes taken by a packet queued by reference, the header and a pointer to the payload
+#define PACKET_QUEUE_REFERENCE_SIZE (PACKET_QUEUE_HEADER_SIZE + sizeof(const uint8_t *))
+
+static_assert(PACKET_BULK_QUEUE_SIZE - 1 >= PACKET_QUEUE_HEADER_SIZE + PACKET_MAX_PAYLOAD, "PACKET_BULK_QUEUE_SIZE must fit the largest packet");
+
+/// @brief Transmit priority of a packet, lower values are sent first
+enum class PacketPriority : uint8_t
+{
+    /// @brief Safety and control: stop commands, acknowledgements
+    Control,
+    /// @brief Commands
+    Command,
+    /// @brief Telemetry and logs
+    Bulk
+};
+
+#define PACKET_PRIORITY_COUNT 3
+
+/// @brief Statistics of a priority class
+typedef struct PacketClassStats
+{
+    /// @brief Packets currently queued
+    uint8_t depth;
+    /// @brief Highest number of packets queued at the same time
+    uint8_t maxDepth;
+    /// @brief Packets sent
+    uint16_t sent;
+    /// @brief Packets rejected because the queue was full or not taken by the link
+    uint16_t dropped;
+    /// @brief Longest time a packet waited in the queue in milliseconds
+    uint16_t maxLatency;
+    /// @brief Sum of the waiting times of the sent packets in milliseconds, divide by sent for the average
+    uint32_t totalLatency;
+} PacketClassStats;
+
+/// @brief Queues packets per priority class and sends them on a PacketLink, highest priority first.
+/// A packet is never interrupted, so a control packet waits at most for the one packet being sent.
+typedef struct PacketScheduler
+{
+public:
+    PacketScheduler(PacketLink *link);
+
+    /// @brief Queues a packet, it gets the next sequence number of the link when it is sent
+    /// @return Returns false if the queue of the class is full or the payload is too long
+    bool send(PacketPriority priority, uint8_t type, const uint8_t *payload, uint8_t length);
+
+    /// @brief Queues a packet with the given sequence number
+    /// @return Returns false if the queue of the class is full or the payload is too long
+    bool send(PacketPriority priority, uint8_t type, uint8_t sequence, const uint8_t *payload, uint8_t length);
+
+    /// @brief Queues a packet with the given sequence number without copying its payload
+    /// @param payload Sent as it is when the packet leaves the queue, it has to stay valid until then
+    /// @return Returns false if the queue of the class is full or the payload is too long
+    bool sendByReference(PacketPriority priority, uint8_t type, uint8_t sequence, const uint8_t *payload, uint8_t length);
+
+    /// @brief Sends the oldest packet of the highest priority class with queued packets
+    /// @note Call whenever the link can take a packet, a blocking stream (the radio) sends one packet per call
+    /// @return Returns true if a packet left the queue
+    bool poll();
+
+    /// @brief Returns true if no packet is queued
+    bool isIdle();
+
+    /// @brief Returns the number of packets queued in a class
+    inline uint8_t depth(PacketPriority priority)
+    {
+        return stats[(uint8_t)priority].depth;
+    }
+
+    PacketClassStats getStats(PacketPriority priority);
+    void resetStats();
+
+private:
+    bool queue(PacketPriority priority, uint8_t type, uint8_t sequence, uint8_t flags, const uint8_t *payload, uint8_t length);
+    /// @brief Sends the oldest packet of a queue
+    template <uint16_t N>
+    void sendNext(RingBuffer<uint8_t, N> *queue, PacketClassStats *classStats);
+
+    PacketLink *link;
+    RingBuffer<uint8_t, PACKET_CONTROL_QUEUE_SIZE> controlQueue;
+    RingBuffer<uint8_t, PACKET_COMMAND_QUEUE_SIZE> commandQueue;
+    RingBuffer<uint8_t, PACKET_BULK_QUEUE_SIZE> bulkQueue;
+    PacketClassStats stats[PACKET_PRIORITY_COUNT];
+} PacketScheduler;
+
+#endif
\ No newline at end of file
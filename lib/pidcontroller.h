@@ -2,36 +2,196 @@
 #define PID_CONTROLLER_H
 
 #include "framework.h"
-#include "PWMMotor.h"
+#include "fixed.h"
 #include "timer.h"
 
-typedef struct PIDController
+/// @brief Converts a clock tick delta into seconds
+inline float toPIDSeconds(ticks_t ticks, float)
+{
+    return Clock::toSeconds(ticks);
+}
+
+/// @brief Converts a clock tick delta into seconds without float math (deltas are capped at about one second)
+template <uint8_t IntBits, uint8_t FracBits>
+inline Fixed<IntBits, FracBits> toPIDSeconds(ticks_t ticks, Fixed<IntBits, FracBits>)
+{
+    static_assert(FracBits <= 16, "toPIDSeconds supports at most 16 fractional bits");
+
+    // seconds = ticks * scale >> 16, with scale rounded from 2^(FracBits + 16) / ticks per second
+    constexpr uint32_t scale = (uint32_t)((((uint64_t)1 << (FracBits + 16)) + CLOCK_TICKS_PER_SECOND / 2) / CLOCK_TICKS_PER_SECOND);
+    // the product stays in 32 bits: a scale rounded up (other clock rates) lowers the cap slightly below one second
+    constexpr uint32_t maxCount = (UINT32_MAX - 0x8000) / scale < CLOCK_TICKS_PER_SECOND ? (UINT32_MAX - 0x8000) / scale
+                                                                                          : CLOCK_TICKS_PER_SECOND;
+    uint32_t count = ticks > maxCount ? maxCount : (uint32_t)ticks;
+    return Fixed<IntBits, FracBits>::fromWide((count * scale + 0x8000) >> 16);
+}
+
+/// @brief PID controller with feedforward for any value
+/// @tparam T The value type (float or a Fixed type)
+/// @note output = F * target + P * error + I * integral(error) - D * filtered d(current)/dt
+template <typename T>
+struct BasicPIDController
 {
 public:
-    /// @brief PID controller for any value
     /// @param clock Reference to a Clock object, used for the PID delta
     /// @param P P coefficient of the controller
-    /// @param threshold Threshold between the current value and the target at which to snap exactly to the target (set to 0 to disable)
-    PIDController(Clock *clock, float P, float threshold);
+    /// @param I I coefficient of the controller
+    /// @param D D coefficient of the controller (applied to the current value, not the error)
+    /// @param F Feedforward coefficient of the controller (applied to the target)
+    /// @param threshold Threshold between the current value and the target at which the target is considered reached
+    BasicPIDController(Clock *clock, T P, T I, T D, T F, T threshold)
+        : timer(clock)
+    {
+        this->target = T();
+        this->P = P;
+        this->I = I;
+        this->D = D;
+        this->F = F;
+        this->threshold = threshold;
+        this->minOutput = T(-1.0f);
+        this->maxOutput = T(1.0f);
+        this->derivativeFilter = T(0.5f);
+        reset();
+    }
 
     /// @brief Sets the PID target value
-    void setTarget(float value);
+    void setTarget(T value)
+    {
+        this->target = value;
+    }
+
     /// @brief Returns the PID target value
-    float getTarget();
+    T getTarget()
+    {
+        return target;
+    }
+
+    void setP(T value) { P = value; }
+    void setI(T value) { I = value; }
+    void setD(T value) { D = value; }
+    void setF(T value) { F = value; }
+    T getP() { return P; }
+    T getI() { return I; }
+    T getD() { return D; }
+    T getF() { return F; }
+
+    /// @brief Sets the range of the output, the integral is clamped to it as well (defaults to [-1, 1])
+    void setOutputLimits(T min, T max)
+    {
+        minOutput = min;
+        maxOutput = max;
+        integral = fmin(maxOutput, fmax(minOutput, integral));
+    }
+
+    /// @brief Sets the smoothing factor of the derivative low-pass filter
+    /// @param factor Weight of the newest derivative sample in (0, 1], 1 disables the filter
+    void setDerivativeFilter(T factor)
+    {
+        derivativeFilter = factor;
+    }
+
+    /// @brief Clears the integral and derivative state
+    void reset()
+    {
+        integral = T();
+        derivative = T();
+        lastCurrent = T();
+        lastDelta = T();
+        lastInverseDelta = T();
+        hasLast = false;
+        timer.reset();
+    }
 
     /// @brief Calculates a PID output based on the current value and the set target
     /// @param current The current value
     /// @return Returns the output from the controller
-    float calculate(float current);
+    T calculate(T current)
+    {
+        // Get elapsed time since last calculate
+        Time delta = timer.elapsed();
+        timer.reset();
+
+        return calculate(current, delta);
+    }
+
+    /// @brief Calculates a PID output based on the current value and the set target
+    /// @param current The current value
+    /// @param delta The time since the last calculation
+    /// @return Returns the output from the controller
+    T calculate(T current, const Time &delta)
+    {
+        const T zero = T();
+        T dt = toPIDSeconds(delta.asTicks(), zero);
+        T error = target - current;
+
+        // derivative on measurement, so target steps do not kick the output
+        if (hasLast && dt > zero)
+        {
+            // the loop runs at a fixed rate, so the division is only redone when the delta changes
+            if (dt != lastDelta)
+            {
+                lastDelta = dt;
+                lastInverseDelta = T(1.0f) / dt;
+            }
+            T rate = (current - lastCurrent) * lastInverseDelta;
+            derivative = derivative + (rate - derivative) * derivativeFilter;
+        }
+        lastCurrent = current;
+        hasLast = true;
+
+        T nextIntegral = fmin(maxOutput, fmax(minOutput, integral + I * error * dt));
+        T output = F * target + P * error + nextIntegral - D * derivative;
+
+        // anti-windup: stop integrating further into the saturated direction
+        if (output > maxOutput)
+        {
+            output = maxOutput;
+            if (error < zero)
+                integral = nextIntegral;
+        }
+        else if (output < minOutput)
+        {
+            output = minOutput;
+            if (error > zero)
+                integral = nextIntegral;
+        }
+        else
+        {
+            integral = nextIntegral;
+        }
+
+        return output;
+    }
 
     /// @brief Returns true if the current value is within the threshold of the target
-    bool atTarget(float current);
+    bool atTarget(T current)
+    {
+        return current >= target - threshold && current <= target + threshold;
+    }
 
 private:
     Timer timer;
-    float target;
-    float P;
-    float threshold;
-} PIDController;
+    T target;
+    T P;
+    T I;
+    T D;
+    T F;
+    T threshold;
+    T minOutput;
+    T maxOutput;
+    T derivativeFilter;
+
+    T integral;
+    T derivative;
+    T lastCurrent;
+    T lastDelta;
+    T lastInverseDelta;
+    bool hasLast;
+};
+
+/// @brief PID controller using float math
+typedef BasicPIDController<float> PIDController;
+/// @brief PID controller using Q16.16 fixed-point math
+typedef BasicPIDController<Q16_16> FixedPIDController;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "framework.h"
+#include "pwmengine.h"
+#include "motor.h"
+
+typedef struct PWMChannel
+{
+    volatile uint8_t *port1;
+    volatile uint8_t *port2;
+    uint8_t mask1;
+    uint8_t mask2;
+    uint16_t phase;
+    uint16_t increment;
+    uint16_t duty;
+    bool clockwise;
+} PWMChannel;
+
+static PWMChannel channels[PWM_ENGINE_CHANNELS];
+static volatile uint8_t channelCount = 0;
+
+ISR(TIMER0_COMPA_vect)
+{
+    for (uint8_t i = 0; i < channelCount; i++)
+    {
+        PWMChannel &ch = channels[i];
+        ch.phase += ch.increment;
+
+        bool on1, on2;
+        if (ch.duty == UINT16_MAX || ch.phase < ch.duty)
+        {
+            on1 = ch.clockwise;
+            on2 = !ch.clockwise;
+        }
+        else
+        {
+            on1 = BRAKE_MODE;
+            on2 = BRAKE_MODE;
+        }
+
+        if (on1)
+            *ch.port1 |= ch.mask1;
+        else
+            *ch.port1 &= ~ch.mask1;
+
+        if (on2)
+            *ch.port2 |= ch.mask2;
+        else
+            *ch.port2 &= ~ch.mask2;
+    }
+}
+
+static volatile uint8_t *portOf(uint8_t pin)
+{
+    switch (pin >> 3)
+    {
+    case 1:
+        return &PORTB;
+    case 2:
+        return &PORTC;
+    case 3:
+        return &PORTD;
+    default:
+        return nullptr;
+    }
+}
+
+bool PWMEngine::enable()
+{
+    unsigned long top = F_CPU / 8UL / PWM_ENGINE_FREQUENCY;
+    if (top == 0 || top > 256)
+        return false;
+
+    uint8_t _SREG = SREG;
+    cli();
+    TCCR0A = (1 << WGM01); // CTC mode
+    TCCR0B = (1 << CS01);  // prescaler 8
+    TCNT0 = 0;
+    OCR0A = (uint8_t)(top - 1);
+    TIFR0 = (1 << OCF0A);
+    TIMSK0 = (1 << OCIE0A);
+    SREG = _SREG;
+
+    sei();
+    return true;
+}
+
+void PWMEngine::disable()
+{
+    TIMSK0 = 0;
+    TCCR0B = 0;
+
+    for (uint8_t i = 0; i < channelCount; i++)
+    {
+        *channels[i].port1 &= ~channels[i].mask1;
+        *channels[i].port2 &= ~channels[i].mask2;
+    }
+    channelCount = 0;
+}
+
+int8_t PWMEngine::attach(uint8_t pin1, uint8_t pin2, float cycleFrequency)
+{
+    volatile uint8_t *port1 = portOf(pin1);
+    volatile uint8_t *port2 = portOf(pin2);
+    if (channelCount >= PWM_ENGINE_CHANNELS || port1 == nullptr || port2 == nullptr)
+        return -1;
+
+    uint8_t index = channelCount;
+    PWMChannel &ch = channels[index];
+    ch.port1 = port1;
+    ch.port2 = port2;
+    ch.mask1 = 1 << (pin1 & 7);
+    ch.mask2 = 1 << (pin2 & 7);
+    ch.phase = 0;
+    // phase advance per interrupt, a full cycle is 65536
+    ch.increment = (uint16_t)(cycleFrequency * 65536.0f / PWM_ENGINE_FREQUENCY + 0.5f);
+    ch.duty = 0;
+    ch.clockwise = true;
+
+    // publish the channel only once it is fully set up
+    channelCount = index + 1;
+    return index;
+}
+
+void PWMEngine::setDuty(int8_t channel, uint16_t duty, bool clockwise)
+{
+    if (channel < 0 || channel >= channelCount)
+        return;
+
+    uint8_t _SREG = SREG;
+    cli();
+    channels[channel].duty = duty;
+    channels[channel].clockwise = clockwise;
+    SREG = _SREG;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef PWM_ENGINE_H
+#define PWM_ENGINE_H
+
+#include "framework.h"
+
+/**
+ * Frequency in Hz of the PWM engine interrupt (phase update rate)
+ * The duty resolution of a channel is PWM_ENGINE_FREQUENCY / cycle frequency steps
+ */
+#ifndef PWM_ENGINE_FREQUENCY
+#define PWM_ENGINE_FREQUENCY 8000
+#endif
+
+/**
+ * Maximum number of two-pin channels driven by the PWM engine
+ */
+#ifndef PWM_ENGINE_CHANNELS
+#define PWM_ENGINE_CHANNELS 6
+#endif
+
+/// @brief Software PWM for two-pin motors driven by the Timer0 compare interrupt.
+/// Every channel has its own 16 bit phase accumulator, so the carrier frequency does not depend on the main loop.
+namespace PWMEngine
+{
+    /// @brief Starts the PWM interrupt
+    /// @return Returns false if PWM_ENGINE_FREQUENCY can not be generated by Timer0
+    bool enable();
+    /// @brief Stops the PWM interrupt and releases all channels
+    void disable();
+
+    /// @brief Adds a channel driving two pins
+    /// @param pin1 The first pin (IOPort32 index, positive when clockwise)
+    /// @param pin2 The second pin (IOPort32 index, positive when counterclockwise)
+    /// @param cycleFrequency The frequency in Hz of the PWM cycle
+    /// @return Returns the channel index or -1 if no channel is available
+    int8_t attach(uint8_t pin1, uint8_t pin2, float cycleFrequency);
+
+    /// @brief Sets the duty cycle of a channel
+    /// @param channel The channel index returned by attach()
+    /// @param duty Duty cycle (0 is always off, UINT16_MAX is always on)
+    /// @param clockwise Direction the motor spins during the on phase
+    void setDuty(int8_t channel, uint16_t duty, bool clockwise);
+}
+
+#endif
\ No newline at end of file
@@ -4,17 +4,107 @@
 #define PU_BAUD_RATE 9600L
 
 #include "internal/picoUART/picoUART.h"
+#include "ringbuffer.h"
 #include <avr/pgmspace.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define RADIO_PWR_PIN _D6
 #define RADIO_SET_PIN _D7
 
-#define MAX_LINE_LENGTH 16
-char line[MAX_LINE_LENGTH];
+// Receiving is interrupt driven on the free running clock timer (Timer1), RX is on ICP1 (PB0):
+// the input capture timestamps the falling edge of the start bit, then compare B
+// fires in the middle of every data bit and of the stop bit to sample the pin.
+// The capture is done in hardware, so a late interrupt does not shift the sampling points.
+
+/// @brief Timer1 ticks per bit
+#define RADIO_BIT_TICKS ((CLOCK_TICKS_PER_SECOND + PU_BAUD_RATE / 2) / PU_BAUD_RATE)
+
+static_assert(RADIO_BIT_TICKS > 64, "Radio baud rate is too high for interrupt driven receiving");
+
+static RingBuffer<uint8_t, RADIO_RX_BUFFER_SIZE> rxBuffer;
+static volatile uint16_t framingErrors = 0;
+static uint8_t rxData;
+/* number of data bits sampled so far */
+static uint8_t rxBits;
+
+ISR(TIMER1_CAPT_vect)
+{
+    OCR1B = ICR1 + RADIO_BIT_TICKS + RADIO_BIT_TICKS / 2;
+    rxBits = 0;
+    TIFR1 = (1 << OCF1B);
+    TIMSK1 = (TIMSK1 & ~(1 << ICIE1)) | (1 << OCIE1B);
+}
+
+ISR(TIMER1_COMPB_vect)
+{
+    bool high = pin(PU_RX) & (1 << bit(PU_RX));
+    if (rxBits < 8)
+    {
+        // LSB first
+        rxData = (rxData >> 1) | (high ? 0x80 : 0);
+        rxBits++;
+        OCR1B += RADIO_BIT_TICKS;
+        return;
+    }
+
+    if (high)
+    {
+        uint8_t data = rxData;
+        rxBuffer.push(data);
+    }
+    else
+    {
+        framingErrors++;
+    }
+
+    // edges of the data bits also set the capture flag, only the next start bit may trigger
+    TIFR1 = (1 << ICF1);
+    TIMSK1 = (TIMSK1 & ~(1 << OCIE1B)) | (1 << ICIE1);
+}
+
+static int readByte(const Time &timeout)
+{
+    uint8_t data;
+    if (rxBuffer.pop(&data))
+        return data;
+
+    Time start = Clock::time();
+    while (Clock::time() - start < timeout)
+    {
+        if (rxBuffer.pop(&data))
+            return data;
+    }
+    return -1;
+}
+
+static void startReceive()
+{
+    uint8_t _SREG = SREG;
+    cli();
+    // falling edge with the noise canceler, keeps the clock prescaler and mode
+    TCCR1B = (TCCR1B & ~(1 << ICES1)) | (1 << ICNC1);
+    TIFR1 = (1 << ICF1);
+    TIMSK1 = (TIMSK1 & ~(1 << OCIE1B)) | (1 << ICIE1);
+    SREG = _SREG;
+}
+
+static void stopReceive()
+{
+    uint8_t _SREG = SREG;
+    cli();
+    TIMSK1 &= ~((1 << ICIE1) | (1 << OCIE1B));
+    SREG = _SREG;
+}
 
 Radio::Radio(IOPort *io)
 {
     this->io = io;
+    queueHead = nullptr;
+    queueTail = nullptr;
+    position = 0;
+    length = 0;
+    sending = false;
     io->reset(RADIO_PWR_PIN);
     io->reset(RADIO_SET_PIN);
     io->set_dir(RADIO_PWR_PIN, IODir::Out);
@@ -30,12 +120,14 @@ Radio::Radio(IOPort *io)
 
 void Radio::disable()
 {
+    stopReceive();
     io->put(RADIO_PWR_PIN, false);
 }
 
 void Radio::enable()
 {
     io->put(RADIO_PWR_PIN, true);
+    startReceive();
 }
 
 void Radio::enterSetup()
@@ -48,117 +140,480 @@ void Radio::exitSetup()
     io->put(RADIO_SET_PIN, true);
 }
 
-uint8_t rxLine()
+bool Radio::submit(RadioCommand *command)
 {
-    uint8_t i = 0;
-    char c;
-    do
+    if (command->result == RadioResult::Pending)
+        return false;
+
+    command->result = RadioResult::Pending;
+    command->next = nullptr;
+    if (queueTail == nullptr)
     {
-        c = pu_rx();
-        line[i++] = c;
-    } while (c != '\n' && i < MAX_LINE_LENGTH);
-    return i;
+        queueHead = command;
+        queueTail = command;
+        startCommand(command);
+    }
+    else
+    {
+        queueTail->next = command;
+        queueTail = command;
+    }
+    return true;
 }
 
-void echoLine()
+void Radio::startCommand(RadioCommand *command)
 {
-    uint8_t len = rxLine();
-    for (uint8_t i = 0; i < len; i++)
+    int len = 0;
+    switch (command->type)
     {
-        putchar(line[i]);
+    case RadioCommandType::Test:
+        len = sprintf_P(line, PSTR("AT"));
+        break;
+    case RadioCommandType::SetBaud:
+        len = sprintf_P(line, PSTR("AT+B%ld"), command->baud);
+        break;
+    case RadioCommandType::SetChannel:
+        len = sprintf_P(line, PSTR("AT+C%03u"), command->channel);
+        break;
+    case RadioCommandType::SetMode:
+        switch (command->mode)
+        {
+        case RadioMode::FastPowerSaving:
+            len = sprintf_P(line, PSTR("AT+FU1"));
+            break;
+        case RadioMode::SlowPowerSaving:
+            len = sprintf_P(line, PSTR("AT+FU2"));
+            break;
+        case RadioMode::Normal:
+            len = sprintf_P(line, PSTR("AT+FU3"));
+            break;
+        case RadioMode::UltraLongDistance:
+            len = sprintf_P(line, PSTR("AT+FU4"));
+            break;
+        }
+        break;
+    case RadioCommandType::SetPower:
+        len = sprintf_P(line, PSTR("AT+P%u"), command->power);
+        break;
+    case RadioCommandType::SetUart:
+        len = sprintf_P(line, PSTR("AT+U%u%c%u"), command->uart.dataBits,
+                        command->uart.parity == RadioParity::Even  ? 'E'
+                        : command->uart.parity == RadioParity::Odd ? 'O'
+                                                                   : 'N',
+                        command->uart.stopBits);
+        break;
+    case RadioCommandType::GetBaud:
+        len = sprintf_P(line, PSTR("AT+RB"));
+        break;
+    case RadioCommandType::GetChannel:
+        len = sprintf_P(line, PSTR("AT+RC"));
+        break;
+    case RadioCommandType::GetMode:
+        len = sprintf_P(line, PSTR("AT+RF"));
+        break;
+    case RadioCommandType::GetPower:
+        len = sprintf_P(line, PSTR("AT+RP"));
+        break;
+    case RadioCommandType::GetVersion:
+        len = sprintf_P(line, PSTR("AT+V"));
+        break;
+    case RadioCommandType::Sleep:
+        len = sprintf_P(line, PSTR("AT+SLEEP"));
+        break;
+    case RadioCommandType::Reset:
+        len = sprintf_P(line, PSTR("AT+DEFAULT"));
+        break;
     }
+
+    // anything received before the command is not part of the reply
+    rxBuffer.clear();
+    length = len;
+    position = 0;
+    sending = true;
 }
 
-void Radio::performTest()
+/// @brief Returns the text after prefix if line starts with it, nullptr otherwise
+static const char *afterPrefix(const char *line, PGM_P prefix)
 {
-    prints_P(PSTR("AT"));
-    echoLine();
+    size_t len = strlen_P(prefix);
+    return strncmp_P(line, prefix, len) == 0 ? line + len : nullptr;
 }
 
-void Radio::setBaud(long baud)
+RadioResult Radio::parseReply(RadioCommand *command)
 {
-    int len = sprintf_P(line, PSTR("AT+B%i"), baud);
-    for (int i = 0; i < len; i++)
+    const char *value;
+    switch (command->type)
     {
-        pu_tx(line[i]);
+    case RadioCommandType::Test:
+        return afterPrefix(line, PSTR("OK")) ? RadioResult::Done : RadioResult::Error;
+    case RadioCommandType::SetBaud:
+        return afterPrefix(line, PSTR("OK+B")) ? RadioResult::Done : RadioResult::Error;
+    case RadioCommandType::SetChannel:
+        return afterPrefix(line, PSTR("OK+C")) ? RadioResult::Done : RadioResult::Error;
+    case RadioCommandType::SetMode:
+        return afterPrefix(line, PSTR("OK+FU")) ? RadioResult::Done : RadioResult::Error;
+    case RadioCommandType::SetPower:
+        return afterPrefix(line, PSTR("OK+P")) ? RadioResult::Done : RadioResult::Error;
+    case RadioCommandType::SetUart:
+        return afterPrefix(line, PSTR("OK+U")) ? RadioResult::Done : RadioResult::Error;
+    case RadioCommandType::GetBaud:
+        // OK+B9600
+        if (!(value = afterPrefix(line, PSTR("OK+B"))) || !isdigit(*value))
+            return RadioResult::Error;
+        command->baud = atol(value);
+        return RadioResult::Done;
+    case RadioCommandType::GetChannel:
+        // OK+RC001
+        if (!(value = afterPrefix(line, PSTR("OK+RC"))) || !isdigit(*value))
+            return RadioResult::Error;
+        command->channel = atoi(value);
+        return RadioResult::Done;
+    case RadioCommandType::GetMode:
+        // OK+FU3
+        if (!(value = afterPrefix(line, PSTR("OK+FU"))))
+            return RadioResult::Error;
+        switch (*value)
+        {
+        case '1':
+            command->mode = RadioMode::FastPowerSaving;
+            return RadioResult::Done;
+        case '2':
+            command->mode = RadioMode::SlowPowerSaving;
+            return RadioResult::Done;
+        case '3':
+            command->mode = RadioMode::Normal;
+            return RadioResult::Done;
+        case '4':
+            command->mode = RadioMode::UltraLongDistance;
+            return RadioResult::Done;
+        default:
+            return RadioResult::Error;
+        }
+    case RadioCommandType::GetPower:
+    {
+        // OK+RP:+20dBm, the levels are 3 dBm apart starting at -1 dBm
+        if (!(value = afterPrefix(line, PSTR("OK+RP:"))))
+            return RadioResult::Error;
+        int dbm = atoi(value);
+        if (dbm < -1 || dbm > 20 || (dbm + 1) % 3 != 0)
+            return RadioResult::Error;
+        command->power = RADIO_POWER_NEG_1 + (dbm + 1) / 3;
+        return RadioResult::Done;
+    }
+    case RadioCommandType::GetVersion:
+        // the version string has no fixed format (www.hc01.com HC-12_V2.4)
+        if (line[0] == 0)
+            return RadioResult::Error;
+        strcpy(command->version, line);
+        return RadioResult::Done;
+    case RadioCommandType::Sleep:
+        return afterPrefix(line, PSTR("OK+SLEEP")) ? RadioResult::Done : RadioResult::Error;
+    case RadioCommandType::Reset:
+        return afterPrefix(line, PSTR("OK+DEFAULT")) ? RadioResult::Done : RadioResult::Error;
+    default:
+        return RadioResult::Error;
     }
-    echoLine();
 }
 
-void Radio::setChannel(uint8_t channel)
+void Radio::finishCommand(RadioResult result)
 {
-    int len = sprintf_P(line, PSTR("AT+C%03u"), channel);
-    for (int i = 0; i < len; i++)
-    {
-        pu_tx(line[i]);
-    }
-    echoLine();
+    RadioCommand *command = queueHead;
+    queueHead = command->next;
+    if (queueHead == nullptr)
+        queueTail = nullptr;
+
+    command->result = result;
+    if (command->callback != nullptr)
+        command->callback(command);
+
+    if (queueHead != nullptr)
+        startCommand(queueHead);
 }
 
-void Radio::setMode(RadioMode mode)
+void Radio::poll()
 {
-    switch (mode)
+    RadioCommand *command = queueHead;
+    if (command == nullptr)
+        return;
+
+    if (sending)
     {
-    case RadioMode::FastPowerSaving:
-        prints_P(PSTR("AT+FU1"));
-        break;
-    case RadioMode::SlowPowerSaving:
-        prints_P(PSTR("AT+FU2"));
-        break;
-    case RadioMode::Normal:
-        prints_P(PSTR("AT+FU3"));
-        break;
-    case RadioMode::UltraLongDistance:
-        prints_P(PSTR("AT+FU4"));
-        break;
+        // one character per call, pu_tx blocks for the whole character
+        pu_tx(line[position++]);
+        if (position == length)
+        {
+            sending = false;
+            position = 0;
+            deadline = Clock::time() + RADIO_COMMAND_TIMEOUT;
+        }
+        return;
     }
-    echoLine();
+
+    uint8_t data;
+    while (rxBuffer.pop(&data))
+    {
+        if (data == '\r')
+            continue;
+        if (data == '\n')
+        {
+            line[position] = 0;
+            finishCommand(parseReply(command));
+            return;
+        }
+        // a reply longer than the line is cut off, the rest is dropped
+        if (position < RADIO_LINE_LENGTH - 1)
+            line[position++] = data;
+    }
+
+    if (Clock::time() >= deadline)
+        finishCommand(RadioResult::Timeout);
+}
+
+bool Radio::isIdle()
+{
+    return queueHead == nullptr;
 }
 
-void Radio::setPower(uint8_t power)
+RadioResult Radio::wait(RadioCommand *command)
 {
-    int len = sprintf_P(line, PSTR("AT+P%u"), power);
-    for (int i = 0; i < len; i++)
+    while (command->result == RadioResult::Pending)
     {
-        pu_tx(line[i]);
+        poll();
     }
-    echoLine();
+    return command->result;
 }
 
-void Radio::setUart(uint8_t dataBits, RadioParity parity, uint8_t stopBits)
+PGM_P Radio::nameOfResult(RadioResult result)
 {
-    int len;
-    switch (parity)
+    switch (result)
     {
-    case RadioParity::None:
-        len = sprintf_P(line, PSTR("AT+U%uN%u"), dataBits, stopBits);
-        break;
-    case RadioParity::Even:
-        len = sprintf_P(line, PSTR("AT+U%uE%u"), dataBits, stopBits);
-        break;
-    case RadioParity::Odd:
-        len = sprintf_P(line, PSTR("AT+U%uO%u"), dataBits, stopBits);
-        break;
+    case RadioResult::Pending:
+        return PSTR("PENDING");
+    case RadioResult::Done:
+        return PSTR("DONE");
+    case RadioResult::Error:
+        return PSTR("ERROR");
+    case RadioResult::Timeout:
+        return PSTR("TIMEOUT");
     default:
-        return;
+        return PSTR("UNKNOWN");
     }
+}
 
-    for (int i = 0; i < len; i++)
-    {
-        pu_tx(line[i]);
-    }
-    echoLine();
+bool Radio::performTest(RadioCommand *command)
+{
+    if (command->result == RadioResult::Pending)
+        return false;
+    command->type = RadioCommandType::Test;
+    return submit(command);
 }
 
-void Radio::getBaud() {}
-void Radio::getChannel() {}
-void Radio::getMode() {}
-void Radio::getPower() {}
-void Radio::getVersion() {}
+bool Radio::setBaud(long baud, RadioCommand *command)
+{
+    if (command->result == RadioResult::Pending)
+        return false;
+    command->type = RadioCommandType::SetBaud;
+    command->baud = baud;
+    return submit(command);
+}
 
-void Radio::sleep() {}
+bool Radio::setChannel(uint8_t channel, RadioCommand *command)
+{
+    if (command->result == RadioResult::Pending)
+        return false;
+    command->type = RadioCommandType::SetChannel;
+    command->channel = channel;
+    return submit(command);
+}
+
+bool Radio::setMode(RadioMode mode, RadioCommand *command)
+{
+    if (command->result == RadioResult::Pending)
+        return false;
+    command->type = RadioCommandType::SetMode;
+    command->mode = mode;
+    return submit(command);
+}
 
-void Radio::reset() {}
+bool Radio::setPower(uint8_t power, RadioCommand *command)
+{
+    if (command->result == RadioResult::Pending)
+        return false;
+    command->type = RadioCommandType::SetPower;
+    command->power = power;
+    return submit(command);
+}
+
+bool Radio::setUart(uint8_t dataBits, RadioParity parity, uint8_t stopBits, RadioCommand *command)
+{
+    if (command->result == RadioResult::Pending)
+        return false;
+    command->type = RadioCommandType::SetUart;
+    command->uart.dataBits = dataBits;
+    command->uart.parity = parity;
+    command->uart.stopBits = stopBits;
+    return submit(command);
+}
+
+bool Radio::getBaud(RadioCommand *command)
+{
+    if (command->result == RadioResult::Pending)
+        return false;
+    command->type = RadioCommandType::GetBaud;
+    return submit(command);
+}
+
+bool Radio::getChannel(RadioCommand *command)
+{
+    if (command->result == RadioResult::Pending)
+        return false;
+    command->type = RadioCommandType::GetChannel;
+    return submit(command);
+}
+
+bool Radio::getMode(RadioCommand *command)
+{
+    if (command->result == RadioResult::Pending)
+        return false;
+    command->type = RadioCommandType::GetMode;
+    return submit(command);
+}
+
+bool Radio::getPower(RadioCommand *command)
+{
+    if (command->result == RadioResult::Pending)
+        return false;
+    command->type = RadioCommandType::GetPower;
+    return submit(command);
+}
+
+bool Radio::getVersion(char *version, RadioCommand *command)
+{
+    if (command->result == RadioResult::Pending)
+        return false;
+    command->type = RadioCommandType::GetVersion;
+    command->version = version;
+    return submit(command);
+}
+
+bool Radio::sleep(RadioCommand *command)
+{
+    if (command->result == RadioResult::Pending)
+        return false;
+    command->type = RadioCommandType::Sleep;
+    return submit(command);
+}
+
+bool Radio::reset(RadioCommand *command)
+{
+    if (command->result == RadioResult::Pending)
+        return false;
+    command->type = RadioCommandType::Reset;
+    return submit(command);
+}
+
+RadioResult Radio::performTest()
+{
+    RadioCommand command;
+    performTest(&command);
+    return wait(&command);
+}
+
+RadioResult Radio::setBaud(long baud)
+{
+    RadioCommand command;
+    setBaud(baud, &command);
+    return wait(&command);
+}
+
+RadioResult Radio::setChannel(uint8_t channel)
+{
+    RadioCommand command;
+    setChannel(channel, &command);
+    return wait(&command);
+}
+
+RadioResult Radio::setMode(RadioMode mode)
+{
+    RadioCommand command;
+    setMode(mode, &command);
+    return wait(&command);
+}
+
+RadioResult Radio::setPower(uint8_t power)
+{
+    RadioCommand command;
+    setPower(power, &command);
+    return wait(&command);
+}
+
+RadioResult Radio::setUart(uint8_t dataBits, RadioParity parity, uint8_t stopBits)
+{
+    RadioCommand command;
+    setUart(dataBits, parity, stopBits, &command);
+    return wait(&command);
+}
+
+RadioResult Radio::getBaud(long *baud)
+{
+    RadioCommand command;
+    getBaud(&command);
+    RadioResult result = wait(&command);
+    if (result == RadioResult::Done)
+        *baud = command.baud;
+    return result;
+}
+
+RadioResult Radio::getChannel(uint8_t *channel)
+{
+    RadioCommand command;
+    getChannel(&command);
+    RadioResult result = wait(&command);
+    if (result == RadioResult::Done)
+        *channel = command.channel;
+    return result;
+}
+
+RadioResult Radio::getMode(RadioMode *mode)
+{
+    RadioCommand command;
+    getMode(&command);
+    RadioResult result = wait(&command);
+    if (result == RadioResult::Done)
+        *mode = command.mode;
+    return result;
+}
+
+RadioResult Radio::getPower(uint8_t *power)
+{
+    RadioCommand command;
+    getPower(&command);
+    RadioResult result = wait(&command);
+    if (result == RadioResult::Done)
+        *power = command.power;
+    return result;
+}
+
+RadioResult Radio::getVersion(char *version)
+{
+    RadioCommand command;
+    getVersion(version, &command);
+    return wait(&command);
+}
+
+RadioResult Radio::sleep()
+{
+    RadioCommand command;
+    sleep(&command);
+    return wait(&command);
+}
+
+RadioResult Radio::reset()
+{
+    RadioCommand command;
+    reset(&command);
+    return wait(&command);
+}
 
 void Radio::send(uint8_t data)
 {
@@ -173,10 +628,79 @@ void Radio::send(uint8_t *data, int offset, int count)
     }
 }
 
-void Radio::request(uint8_t *buf, int offset, int count)
+uint8_t Radio::available()
 {
-    for (int i = 0; i < count; i++)
+    return rxBuffer.count();
+}
+
+int Radio::read()
+{
+    uint8_t data;
+    return rxBuffer.pop(&data) ? data : -1;
+}
+
+int Radio::read(const Time &timeout)
+{
+    return readByte(timeout);
+}
+
+int Radio::request(uint8_t *buf, int offset, int count, const Time &timeout)
+{
+    Time start = Clock::time();
+    int i = 0;
+    while (i < count)
     {
-        buf[i] = pu_rx();
+        i += rxBuffer.pop(buf + offset + i, count - i > 0xFF ? 0xFF : count - i);
+        if (i < count && Clock::time() - start >= timeout)
+            break;
     }
+    return i;
+}
+
+void Radio::flush()
+{
+    rxBuffer.clear();
+}
+
+static int sput(uint8_t data, ByteStream *stream)
+{
+    pu_tx(data);
+    return 0;
+}
+
+static int sget(ByteStream *stream, bool last)
+{
+    uint8_t data;
+    return rxBuffer.pop(&data) ? data : -1;
+}
+
+static int slen(ByteStream *stream)
+{
+    return rxBuffer.count();
+}
+
+ByteStream Radio::getStream()
+{
+    return ByteStream(sput, sget, slen);
+}
+
+RadioStats Radio::getStats()
+{
+    RadioStats stats;
+    stats.receiveOverflows = rxBuffer.getOverflows();
+    uint8_t _SREG = SREG;
+    cli();
+    stats.framingErrors = framingErrors;
+    SREG = _SREG;
+    stats.receiveHighWaterMark = rxBuffer.getHighWaterMark();
+    return stats;
+}
+
+void Radio::resetStats()
+{
+    rxBuffer.resetStats();
+    uint8_t _SREG = SREG;
+    cli();
+    framingErrors = 0;
+    SREG = _SREG;
 }
\ No newline at end of file
@@ -3,6 +3,23 @@
 
 #include "framework.h"
 #include "ioutils.h"
+#include "clock.h"
+#include "bytestream.h"
+
+#ifndef RADIO_RX_BUFFER_SIZE
+/** Size of the radio receive buffer (power of two, one slot stays empty) */
+#define RADIO_RX_BUFFER_SIZE 64
+#endif
+
+#ifndef RADIO_COMMAND_TIMEOUT
+/** Longest wait for the reply to an AT command */
+#define RADIO_COMMAND_TIMEOUT Time::fromMillis(250)
+#endif
+
+/// @brief Longest AT command or reply line
+#define RADIO_LINE_LENGTH 32
+/// @brief Size of the buffer for the version string (getVersion)
+#define RADIO_VERSION_LENGTH RADIO_LINE_LENGTH
 
 enum class RadioMode
 {
@@ -33,39 +50,193 @@ enum class RadioParity
 #define RADIO_STOPBIT_2 2
 #define RADIO_STOPBIT_1_5 3
 
+/// @brief Result of a queued AT command
+enum class RadioResult : uint8_t
+{
+    /// @brief Queued or in progress
+    Pending,
+    /// @brief The radio confirmed the command, the value of a query is filled in
+    Done,
+    /// @brief The reply was not the expected one
+    Error,
+    /// @brief No reply within RADIO_COMMAND_TIMEOUT (is the radio in setup mode?)
+    Timeout
+};
+
+enum class RadioCommandType : uint8_t
+{
+    Test,
+    SetBaud,
+    SetChannel,
+    SetMode,
+    SetPower,
+    SetUart,
+    GetBaud,
+    GetChannel,
+    GetMode,
+    GetPower,
+    GetVersion,
+    Sleep,
+    Reset
+};
+
+struct RadioCommand;
+
+/// @brief Called when a queued command finished
+/// @note Runs inside Radio::poll()
+typedef void (*RadioCallback)(RadioCommand *command);
+
+/// @brief Descriptor of a queued AT command, owned by the caller and must stay valid until the result is no longer Pending
+typedef struct RadioCommand
+{
+    RadioCommand()
+        : type(RadioCommandType::Test), baud(0), callback(nullptr), context(nullptr), result(RadioResult::Done), next(nullptr)
+    {
+    }
+
+    RadioCommandType type;
+    /// @brief Argument of a setter or value of a query
+    union
+    {
+        long baud;
+        uint8_t channel;
+        RadioMode mode;
+        /// @brief One of RADIO_POWER_*
+        uint8_t power;
+        struct
+        {
+            uint8_t dataBits;
+            RadioParity parity;
+            uint8_t stopBits;
+        } uart;
+        /// @brief Buffer of RADIO_VERSION_LENGTH characters receiving the version string
+        char *version;
+    };
+    /// @brief Optional completion callback
+    RadioCallback callback;
+    /// @brief User pointer for the callback
+    void *context;
+    RadioResult result;
+
+    // managed by the command queue
+    RadioCommand *next;
+} RadioCommand;
+
+/// @brief Receive statistics of the radio
+typedef struct RadioStats
+{
+    /// @brief Bytes dropped because the receive buffer was full
+    uint16_t receiveOverflows;
+    /// @brief Bytes dropped because the stop bit was not high
+    uint16_t framingErrors;
+    /// @brief Highest number of bytes waiting in the receive buffer
+    uint8_t receiveHighWaterMark;
+} RadioStats;
+
 typedef struct Radio
 {
 public:
+    /// @note The receiver uses Timer1, so Clock::init() must be called first
     Radio(IOPort *io);
 
+    /// @brief Powers the radio off and stops receiving
     void disable();
+    /// @brief Powers the radio on and starts receiving in the background
     void enable();
     void enterSetup();
     void exitSetup();
 
-    void performTest();
-    void setBaud(long baud);
-    void setChannel(uint8_t channel);
-    void setMode(RadioMode mode);
-    void setPower(uint8_t power);
-    void setUart(uint8_t dataBits, RadioParity parity, uint8_t stopBits);
+    // AT commands (setup mode only): the versions with a RadioCommand queue the command and return immediately,
+    // they return false if the command is still pending. The others wait for the result.
 
-    void getBaud();
-    void getChannel();
-    void getMode();
-    void getPower();
-    void getVersion();
+    bool performTest(RadioCommand *command);
+    bool setBaud(long baud, RadioCommand *command);
+    bool setChannel(uint8_t channel, RadioCommand *command);
+    bool setMode(RadioMode mode, RadioCommand *command);
+    bool setPower(uint8_t power, RadioCommand *command);
+    bool setUart(uint8_t dataBits, RadioParity parity, uint8_t stopBits, RadioCommand *command);
+    bool getBaud(RadioCommand *command);
+    bool getChannel(RadioCommand *command);
+    bool getMode(RadioCommand *command);
+    bool getPower(RadioCommand *command);
+    /// @param version Buffer of RADIO_VERSION_LENGTH characters
+    bool getVersion(char *version, RadioCommand *command);
+    /// @brief The radio goes to sleep once it leaves setup mode, entering setup mode wakes it up
+    bool sleep(RadioCommand *command);
+    /// @brief Restores the factory settings
+    bool reset(RadioCommand *command);
 
-    void sleep();
+    RadioResult performTest();
+    RadioResult setBaud(long baud);
+    RadioResult setChannel(uint8_t channel);
+    RadioResult setMode(RadioMode mode);
+    RadioResult setPower(uint8_t power);
+    RadioResult setUart(uint8_t dataBits, RadioParity parity, uint8_t stopBits);
+    RadioResult getBaud(long *baud);
+    RadioResult getChannel(uint8_t *channel);
+    RadioResult getMode(RadioMode *mode);
+    RadioResult getPower(uint8_t *power);
+    RadioResult getVersion(char *version);
+    RadioResult sleep();
+    RadioResult reset();
 
-    void reset();
+    /// @brief Queues an AT command
+    /// @return Returns false if the command is still pending
+    bool submit(RadioCommand *command);
+    /// @brief Sends and answers the queued commands one step at a time, call regularly from the main loop
+    void poll();
+    /// @brief Returns true if no command is queued or running
+    bool isIdle();
+    /// @brief Polls until the command is finished
+    /// @return Returns the result of the command
+    RadioResult wait(RadioCommand *command);
+    /// @brief Returns the name of a result in program memory (print with %S)
+    static PGM_P nameOfResult(RadioResult result);
 
     void send(uint8_t data);
     void send(uint8_t *data, int offset, int count);
-    void request(uint8_t *buf, int offset, int count);
+
+    /// @brief Returns the number of received bytes waiting to be read
+    uint8_t available();
+
+    /// @brief Reads a received byte without waiting
+    /// @return Returns the byte or -1 if nothing was received
+    int read();
+
+    /// @brief Waits up to timeout for a received byte
+    /// @return Returns the byte or -1 if nothing was received in time
+    int read(const Time &timeout);
+
+    /// @brief Waits up to timeout for count bytes
+    /// @return Returns the number of bytes read
+    int request(uint8_t *buf, int offset, int count, const Time &timeout);
+
+    /// @brief Discards all received bytes
+    void flush();
+
+    /// @brief Returns a ByteStream sending with send() and reading the received bytes without waiting
+    ByteStream getStream();
+
+    RadioStats getStats();
+    void resetStats();
 
 private:
+    /// @brief Formats the AT command text into line
+    void startCommand(RadioCommand *command);
+    /// @brief Checks the reply in line and fills in the value of a query
+    RadioResult parseReply(RadioCommand *command);
+    void finishCommand(RadioResult result);
+
     IOPort *io;
+
+    RadioCommand *queueHead;
+    RadioCommand *queueTail;
+    /* characters of the command sent so far, or of the reply received so far */
+    uint8_t position;
+    uint8_t length;
+    bool sending;
+    Time deadline;
+    char line[RADIO_LINE_LENGTH];
 } Radio;
 
 #endif
\ No newline at end of file
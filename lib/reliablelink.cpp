@@ -0,0 +1,223 @@
+#include "reliablelink.h"
+#include <string.h>
+
+#define WINDOW_MASK (RELIABLE_WINDOW_SIZE - 1)
+#define RETRANSMIT_TIMEOUT_STAMPS ((uint16_t)Clock::toStamps(RELIABLE_RETRANSMIT_TIMEOUT.asTicks()))
+
+ReliableLink::ReliableLink(PacketLink *link, PacketScheduler *scheduler)
+{
+    this->link = link;
+    this->scheduler = scheduler;
+    stats = {};
+    txBase = 0;
+    txNext = 0;
+    rxExpected = 0;
+    incoming = nullptr;
+    incomingFromWindow = false;
+    for (uint8_t i = 0; i < RELIABLE_WINDOW_SIZE; i++)
+    {
+        txSlots[i].used = false;
+        rxSlots[i].used = false;
+    }
+}
+
+bool ReliableLink::send(uint8_t type, const uint8_t *payload, uint8_t length, PacketPriority priority)
+{
+    if (!canSend() || length > PACKET_MAX_PAYLOAD || (type & PACKET_RELIABLE) || type == PACKET_ACK)
+        return false;
+
+    uint8_t sequence = txNext++;
+    ReliableSendSlot *slot = &txSlots[sequence & WINDOW_MASK];
+    slot->used = true;
+    slot->acked = false;
+    slot->type = type | PACKET_RELIABLE;
+    slot->length = length;
+    slot->priority = priority;
+    memcpy(slot->payload, payload, length);
+
+    stats.sent++;
+    // a packet the link or scheduler did not take is tried again on the next poll()
+    transmit(sequence);
+    return true;
+}
+
+bool ReliableLink::sendUnreliable(uint8_t type, const uint8_t *payload, uint8_t length, PacketPriority priority)
+{
+    if ((type & PACKET_RELIABLE) || type == PACKET_ACK)
+        return false;
+    if (scheduler != nullptr)
+        return scheduler->send(priority, type, payload, length);
+    return link->send(type, payload, length);
+}
+
+bool ReliableLink::transmit(uint8_t sequence)
+{
+    ReliableSendSlot *slot = &txSlots[sequence & WINDOW_MASK];
+    // the slot outlives a queued reference: it is only reused once the receiver has moved past
+    // the sequence number, so a stale queued copy is dropped there as a duplicate
+    slot->transmitted = scheduler != nullptr ? scheduler->sendByReference(slot->priority, slot->type, sequence, slot->payload, slot->length)
+                                             : link->send(slot->type, sequence, slot->payload, slot->length);
+    if (slot->transmitted)
+        slot->sentAt = Clock::stamp();
+    return slot->transmitted;
+}
+
+void ReliableLink::poll()
+{
+    processIncoming();
+
+    uint16_t now = Clock::stamp();
+    for (uint8_t sequence = txBase; sequence != txNext; sequence++)
+    {
+        ReliableSendSlot *slot = &txSlots[sequence & WINDOW_MASK];
+        if (slot->acked)
+            continue;
+        if (!slot->transmitted)
+        {
+            transmit(sequence);
+        }
+        else if ((uint16_t)(now - slot->sentAt) >= RETRANSMIT_TIMEOUT_STAMPS)
+        {
+            stats.retransmits++;
+            transmit(sequence);
+        }
+    }
+}
+
+const Packet *ReliableLink::receive()
+{
+    processIncoming();
+    return incoming;
+}
+
+void ReliableLink::release()
+{
+    if (incoming == nullptr)
+        return;
+
+    if (incomingFromWindow)
+    {
+        rxSlots[rxExpected & WINDOW_MASK].used = false;
+        rxExpected++;
+        stats.delivered++;
+        // the window moved on, the sender may send the next packets
+        sendAck();
+    }
+    else
+    {
+        link->release();
+    }
+    incoming = nullptr;
+}
+
+void ReliableLink::processIncoming()
+{
+    while (incoming == nullptr)
+    {
+        // the next packet in order comes out of the receive window
+        ReliableReceiveSlot *slot = &rxSlots[rxExpected & WINDOW_MASK];
+        if (slot->used)
+        {
+            windowPacket.type = slot->type & ~PACKET_RELIABLE;
+            windowPacket.sequence = rxExpected;
+            windowPacket.length = slot->length;
+            windowPacket.payload = slot->payload;
+            incoming = &windowPacket;
+            incomingFromWindow = true;
+            return;
+        }
+
+        const Packet *packet = link->receive();
+        if (packet == nullptr)
+            return;
+
+        if (packet->type == PACKET_ACK)
+        {
+            handleAck(packet);
+            link->release();
+        }
+        else if (packet->type & PACKET_RELIABLE)
+        {
+            handleData(packet);
+            link->release();
+        }
+        else
+        {
+            incoming = packet;
+            incomingFromWindow = false;
+        }
+    }
+}
+
+void ReliableLink::handleAck(const Packet *packet)
+{
+    if (packet->length != 2)
+        return;
+
+    uint8_t next = packet->payload[0];
+    uint8_t received = packet->payload[1];
+
+    // a stale acknowledgement may point before the window, ignore it
+    uint8_t inFlight = txNext - txBase;
+    if ((uint8_t)(next - txBase) > inFlight)
+        return;
+
+    while (txBase != next)
+    {
+        txSlots[txBase & WINDOW_MASK].used = false;
+        txBase++;
+    }
+
+    for (uint8_t i = 0; i < RELIABLE_WINDOW_SIZE; i++)
+    {
+        uint8_t sequence = next + i;
+        if ((received & (1 << i)) && (uint8_t)(sequence - txBase) < (uint8_t)(txNext - txBase))
+            txSlots[sequence & WINDOW_MASK].acked = true;
+    }
+}
+
+void ReliableLink::handleData(const Packet *packet)
+{
+    uint8_t offset = packet->sequence - rxExpected;
+    ReliableReceiveSlot *slot = &rxSlots[packet->sequence & WINDOW_MASK];
+    if (offset >= RELIABLE_WINDOW_SIZE || slot->used)
+    {
+        // already received: the acknowledgement got lost, send it again
+        stats.duplicates++;
+        sendAck();
+        return;
+    }
+
+    slot->used = true;
+    slot->type = packet->type;
+    slot->length = packet->length;
+    memcpy(slot->payload, packet->payload, packet->length);
+
+    // the next packet in order is acknowledged once it is handed out, others report the gap now
+    if (offset != 0)
+        sendAck();
+}
+
+void ReliableLink::sendAck()
+{
+    uint8_t ack[2] = {rxExpected, 0};
+    for (uint8_t i = 0; i < RELIABLE_WINDOW_SIZE; i++)
+    {
+        if (rxSlots[(uint8_t)(rxExpected + i) & WINDOW_MASK].used)
+            ack[1] |= 1 << i;
+    }
+    bool sent = scheduler != nullptr ? scheduler->send(PacketPriority::Control, PACKET_ACK, ack, sizeof(ack))
+                                     : link->send(PACKET_ACK, ack, sizeof(ack));
+    if (sent)
+        stats.acks++;
+}
+
+ReliableStats ReliableLink::getStats()
+{
+    return stats;
+}
+
+void ReliableLink::resetStats()
+{
+    stats = {};
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#ifndef RELIABLE_LINK_H
+#define RELIABLE_LINK_H
+
+#include "framework.h"
+#include "clock.h"
+#include "packet.h"
+#include "packetscheduler.h"
+
+#ifndef RELIABLE_WINDOW_SIZE
+/** Number of reliable packets in flight without an acknowledgement (power of two, at most 8) */
+#define RELIABLE_WINDOW_SIZE 2
+#endif
+
+#ifndef RELIABLE_RETRANSMIT_TIMEOUT
+/** Time without an acknowledgement after which a reliable packet is sent again.
+ * A full window of packets takes about 80 ms at 9600 baud. */
+#define RELIABLE_RETRANSMIT_TIMEOUT Time::fromMillis(300)
+#endif
+
+static_assert(Clock::toStamps(RELIABLE_RETRANSMIT_TIMEOUT.asTicks()) <= UINT16_MAX, "RELIABLE_RETRANSMIT_TIMEOUT must fit the 16 bit send timestamps");
+static_assert(RELIABLE_WINDOW_SIZE >= 1 && RELIABLE_WINDOW_SIZE <= 8 && (RELIABLE_WINDOW_SIZE & (RELIABLE_WINDOW_SIZE - 1)) == 0,
+              "RELIABLE_WINDOW_SIZE must be 1, 2, 4 or 8");
+static_assert(PACKET_COMMAND_QUEUE_SIZE - 1 >= RELIABLE_WINDOW_SIZE * PACKET_QUEUE_REFERENCE_SIZE,
+              "PACKET_COMMAND_QUEUE_SIZE must fit a full window of reliable packets");
+static_assert(PACKET_CONTROL_QUEUE_SIZE - 1 >= PACKET_QUEUE_HEADER_SIZE + 2, "PACKET_CONTROL_QUEUE_SIZE must fit an acknowledgement");
+
+/// @brief Statistics of a reliable link
+typedef struct ReliableStats
+{
+    /// @brief Reliable packets sent for the first time
+    uint16_t sent;
+    /// @brief Reliable packets sent again after the retransmit timeout
+    uint16_t retransmits;
+    /// @brief Reliable packets received that were already received before
+    uint16_t duplicates;
+    /// @brief Reliable packets handed out in order
+    uint16_t delivered;
+    /// @brief Acknowledgements sent
+    uint16_t acks;
+} ReliableStats;
+
+/// @brief A packet in the send window
+typedef struct ReliableSendSlot
+{
+    bool used;
+    /// @brief The receiver has buffered the packet
+    bool acked;
+    /// @brief The packet was handed to the link or scheduler, otherwise poll() tries again
+    bool transmitted;
+    uint8_t type;
+    uint8_t length;
+    PacketPriority priority;
+    /// @brief Clock::stamp() of the last transmission
+    uint16_t sentAt;
+    uint8_t payload[PACKET_MAX_PAYLOAD];
+} ReliableSendSlot;
+
+/// @brief A packet in the receive window
+typedef struct ReliableReceiveSlot
+{
+    bool used;
+    uint8_t type;
+    uint8_t length;
+    uint8_t payload[PACKET_MAX_PAYLOAD];
+} ReliableReceiveSlot;
+
+/// @brief Sliding window reliable delivery with selective acknowledgements on a PacketLink.
+/// Reliable packets are delivered once and in order, only the packets missing at the receiver are sent again.
+/// Unreliable packets (telemetry) share the link and are delivered as they arrive.
+/// @note The sequence numbers of both ends start at 0, both ends have to be reset together
+typedef struct ReliableLink
+{
+public:
+    /// @param scheduler Queues the packets by priority before they go out on the link, nullptr to send them right away
+    ReliableLink(PacketLink *link, PacketScheduler *scheduler = nullptr);
+
+    /// @brief Queues a packet for reliable delivery and sends it
+    /// @param type The packet type, without PACKET_RELIABLE and other than PACKET_ACK
+    /// @param priority Priority of the packet and its retransmits (with a scheduler), acknowledgements are sent as Control
+    /// @return Returns false if the send window is full or the packet is invalid
+    bool send(uint8_t type, const uint8_t *payload, uint8_t length, PacketPriority priority = PacketPriority::Command);
+
+    /// @brief Sends a packet once, without acknowledgement
+    bool sendUnreliable(uint8_t type, const uint8_t *payload, uint8_t length, PacketPriority priority = PacketPriority::Bulk);
+
+    /// @brief Returns the number of reliable packets not yet delivered to the other end
+    inline uint8_t pending()
+    {
+        return txNext - txBase;
+    }
+
+    /// @brief Returns true if send() can take another packet
+    inline bool canSend()
+    {
+        return pending() < RELIABLE_WINDOW_SIZE;
+    }
+
+    /// @brief Handles received acknowledgements and sends timed out packets again, call regularly from the main loop
+    void poll();
+
+    /// @brief Returns the next packet, reliable packets have PACKET_RELIABLE removed from their type
+    /// @return Returns the packet or nullptr, the packet stays valid until release()
+    const Packet *receive();
+
+    /// @brief Frees the packet returned by receive()
+    void release();
+
+    ReliableStats getStats();
+    void resetStats();
+
+private:
+    /// @brief Reads packets from the link until one can be handed out
+    void processIncoming();
+    void handleAck(const Packet *packet);
+    void handleData(const Packet *packet);
+    void sendAck();
+    bool transmit(uint8_t sequence);
+
+    PacketLink *link;
+    PacketScheduler *scheduler;
+    ReliableStats stats;
+
+    /* oldest sequence number not delivered to the other end */
+    uint8_t txBase;
+    /* sequence number of the next new packet */
+    uint8_t txNext;
+    ReliableSendSlot txSlots[RELIABLE_WINDOW_SIZE];
+
+    /* next sequence number to hand out */
+    uint8_t rxExpected;
+    ReliableReceiveSlot rxSlots[RELIABLE_WINDOW_SIZE];
+
+    /* packet returned by receive(), nullptr if there is none */
+    const Packet *incoming;
+    /* the incoming packet is from the receive window, otherwise it is held by the link */
+    bool incomingFromWindow;
+    Packet windowPacket;
+} ReliableLink;
+
+#endif
\ No newline at end of file
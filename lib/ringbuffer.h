@@ -0,0 +1,179 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include "framework.h"
+
+/// @brief Single producer, single consumer queue for handing data between an interrupt and the main loop without locks.
+/// The producer only writes the head and the consumer only writes the tail, so either side can be an interrupt.
+/// @tparam T The item type
+/// @tparam N Size of the buffer (power of two, at most 256), one slot stays empty so N - 1 items fit
+template <typename T, uint16_t N>
+struct RingBuffer
+{
+    static_assert(N >= 2 && N <= 256 && (N & (N - 1)) == 0, "RingBuffer size must be a power of two from 2 to 256");
+
+    RingBuffer()
+    {
+        head = 0;
+        tail = 0;
+        overflows = 0;
+        highWaterMark = 0;
+    }
+
+    /// @brief Adds an item (producer)
+    /// @return Returns false and counts an overflow if the buffer is full
+    bool push(const T &item)
+    {
+        uint8_t h = head;
+        uint8_t next = (h + 1) & mask;
+        if (next == tail)
+        {
+            overflows++;
+            return false;
+        }
+
+        items[h] = item;
+        // the item has to be stored before the consumer can see it
+        barrier();
+        head = next;
+
+        uint8_t level = (next - tail) & mask;
+        if (level > highWaterMark)
+            highWaterMark = level;
+        return true;
+    }
+
+    /// @brief Removes the oldest item (consumer)
+    /// @return Returns false if the buffer is empty
+    bool pop(T *item)
+    {
+        uint8_t t = tail;
+        if (t == head)
+            return false;
+
+        *item = items[t];
+        // the item has to be read before the producer can overwrite it
+        barrier();
+        tail = (t + 1) & mask;
+        return true;
+    }
+
+    /// @brief Removes up to count of the oldest items (consumer)
+    /// @return Returns the number of items copied into the buffer
+    uint8_t pop(T *buffer, uint8_t count)
+    {
+        uint8_t t = tail;
+        uint8_t available = (head - t) & mask;
+        if (count > available)
+            count = available;
+
+        for (uint8_t i = 0; i < count; i++)
+        {
+            buffer[i] = items[t];
+            t = (t + 1) & mask;
+        }
+        barrier();
+        tail = t;
+        return count;
+    }
+
+    /// @brief Reads an item without removing it (consumer)
+    /// @param offset Position of the item counted from the oldest one
+    /// @return Returns false if there are not enough items
+    bool peek(T *item, uint8_t offset = 0)
+    {
+        if (offset >= count())
+            return false;
+
+        *item = items[(tail + offset) & mask];
+        return true;
+    }
+
+    /// @brief Removes up to count of the oldest items (consumer)
+    void discard(uint8_t count)
+    {
+        uint8_t available = this->count();
+        if (count > available)
+            count = available;
+
+        barrier();
+        tail = (tail + count) & mask;
+    }
+
+    /// @brief Removes all items (consumer)
+    void clear()
+    {
+        tail = head;
+    }
+
+    /// @brief Returns the number of items in the buffer
+    uint8_t count()
+    {
+        return (head - tail) & mask;
+    }
+
+    /// @brief Returns the number of items that can still be added
+    uint8_t space()
+    {
+        return mask - count();
+    }
+
+    bool isEmpty()
+    {
+        return head == tail;
+    }
+
+    bool isFull()
+    {
+        return ((head + 1) & mask) == tail;
+    }
+
+    /// @brief Returns the number of items that fit into the buffer
+    static constexpr uint8_t capacity()
+    {
+        return mask;
+    }
+
+    /// @brief Returns the number of items rejected because the buffer was full
+    uint16_t getOverflows()
+    {
+        uint8_t _SREG = SREG;
+        cli();
+        uint16_t count = overflows;
+        SREG = _SREG;
+        return count;
+    }
+
+    /// @brief Returns the highest number of items that were in the buffer
+    uint8_t getHighWaterMark()
+    {
+        return highWaterMark;
+    }
+
+    /// @brief Clears the overflow count and high water mark
+    void resetStats()
+    {
+        uint8_t _SREG = SREG;
+        cli();
+        overflows = 0;
+        highWaterMark = 0;
+        SREG = _SREG;
+    }
+
+private:
+    static constexpr uint8_t mask = N - 1;
+
+    /// @brief Keeps the compiler from moving buffer accesses across index updates
+    static inline void barrier()
+    {
+        __asm__ __volatile__("" ::: "memory");
+    }
+
+    T items[N];
+    volatile uint8_t head;
+    volatile uint8_t tail;
+    volatile uint16_t overflows;
+    volatile uint8_t highWaterMark;
+};
+
+#endif
\ No newline at end of file
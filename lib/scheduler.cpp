@@ -0,0 +1,180 @@
+#include "framework.h"
+#include "scheduler.h"
+
+Scheduler::Scheduler(Clock *clock)
+{
+    this->clock = clock;
+    this->idleHook = nullptr;
+    this->heapSize = 0;
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        tasks[i].heapIndex = -1;
+    }
+}
+
+int8_t Scheduler::every(const Time &period, TaskCallback callback, void *context)
+{
+    return schedule(period.asTicks(), period.asTicks(), callback, context);
+}
+
+int8_t Scheduler::after(const Time &delay, TaskCallback callback, void *context)
+{
+    return schedule(delay.asTicks(), 0, callback, context);
+}
+
+int8_t Scheduler::schedule(ticks_t delay, ticks_t period, TaskCallback callback, void *context)
+{
+    if (callback == nullptr)
+        return -1;
+
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        if (tasks[i].heapIndex < 0)
+        {
+            tasks[i].deadline = clock->counter() + delay;
+            tasks[i].period = period;
+            tasks[i].callback = callback;
+            tasks[i].context = context;
+            push(i);
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool Scheduler::cancel(int8_t id)
+{
+    if (!isScheduled(id))
+        return false;
+
+    remove(tasks[id].heapIndex);
+    return true;
+}
+
+bool Scheduler::isScheduled(int8_t id)
+{
+    return id >= 0 && id < SCHEDULER_MAX_TASKS && tasks[id].heapIndex >= 0;
+}
+
+void Scheduler::setIdleHook(IdleHook hook)
+{
+    idleHook = hook;
+}
+
+Time Scheduler::untilNext()
+{
+    if (heapSize == 0)
+        return Time();
+
+    ticks_t now = clock->counter();
+    ticks_t deadline = tasks[heap[0]].deadline;
+    return Time::fromTicks(deadline > now ? deadline - now : 0);
+}
+
+uint8_t Scheduler::poll()
+{
+    uint8_t count = 0;
+    ticks_t now = clock->counter();
+
+    while (heapSize > 0 && tasks[heap[0]].deadline <= now)
+    {
+        uint8_t slot = heap[0];
+        Task &task = tasks[slot];
+        TaskCallback callback = task.callback;
+        void *context = task.context;
+
+        if (task.period > 0)
+        {
+            // keep a fixed rate, but do not run a burst of late periods
+            task.deadline += task.period;
+            if (task.deadline <= now)
+                task.deadline = now + task.period;
+            siftDown(0);
+        }
+        else
+        {
+            remove(0);
+        }
+
+        // the task is rescheduled before it runs, so it can cancel itself
+        callback(context);
+        count++;
+    }
+
+    if (count == 0 && idleHook != nullptr)
+        idleHook();
+
+    return count;
+}
+
+void Scheduler::run()
+{
+    while (1)
+    {
+        poll();
+    }
+}
+
+void Scheduler::push(uint8_t slot)
+{
+    heap[heapSize] = slot;
+    tasks[slot].heapIndex = heapSize;
+    heapSize++;
+    siftUp(heapSize - 1);
+}
+
+void Scheduler::remove(uint8_t heapIndex)
+{
+    uint8_t slot = heap[heapIndex];
+    heapSize--;
+    if (heapIndex != heapSize)
+    {
+        // move the last task into the hole and restore the heap order
+        swap(heapIndex, heapSize);
+        siftDown(heapIndex);
+        siftUp(heapIndex);
+    }
+    tasks[slot].heapIndex = -1;
+}
+
+void Scheduler::siftUp(uint8_t heapIndex)
+{
+    while (heapIndex > 0)
+    {
+        uint8_t parent = (heapIndex - 1) / 2;
+        if (tasks[heap[parent]].deadline <= tasks[heap[heapIndex]].deadline)
+            break;
+        swap(parent, heapIndex);
+        heapIndex = parent;
+    }
+}
+
+void Scheduler::siftDown(uint8_t heapIndex)
+{
+    while (1)
+    {
+        uint8_t smallest = heapIndex;
+        uint8_t left = heapIndex * 2 + 1;
+        uint8_t right = left + 1;
+
+        if (left < heapSize && tasks[heap[left]].deadline < tasks[heap[smallest]].deadline)
+            smallest = left;
+        if (right < heapSize && tasks[heap[right]].deadline < tasks[heap[smallest]].deadline)
+            smallest = right;
+        if (smallest == heapIndex)
+            break;
+
+        swap(smallest, heapIndex);
+        heapIndex = smallest;
+    }
+}
+
+void Scheduler::swap(uint8_t a, uint8_t b)
+{
+    uint8_t slot = heap[a];
+    heap[a] = heap[b];
+    heap[b] = slot;
+    tasks[heap[a]].heapIndex = a;
+    tasks[heap[b]].heapIndex = b;
+}
\ No newline at end of file
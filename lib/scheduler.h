@@ -0,0 +1,78 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "framework.h"
+#include "clock.h"
+
+/**
+ * Maximum number of tasks scheduled at the same time
+ */
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 8
+#endif
+
+/// @brief Cooperative scheduler running periodic and one-shot tasks from the main loop.
+/// Deadlines are clock ticks kept in a min-heap, so finding the next due task is O(1) and rescheduling is O(log n).
+typedef struct Scheduler
+{
+public:
+    /// @brief A scheduled task
+    /// @param context The context pointer passed when the task was scheduled
+    typedef void (*TaskCallback)(void *context);
+    /// @brief Called by poll() when no task is due
+    typedef void (*IdleHook)();
+
+    /// @param clock Reference to a Clock object, used for the task deadlines
+    Scheduler(Clock *clock);
+
+    /// @brief Schedules a task to run periodically, the first run is one period from now
+    /// @return Returns the task id or -1 if no task slot is free
+    int8_t every(const Time &period, TaskCallback callback, void *context = nullptr);
+    /// @brief Schedules a task to run once after a delay
+    /// @return Returns the task id or -1 if no task slot is free
+    int8_t after(const Time &delay, TaskCallback callback, void *context = nullptr);
+    /// @brief Removes a scheduled task (can be called from the task itself)
+    /// @return Returns true if the task was scheduled
+    bool cancel(int8_t id);
+    /// @brief Returns true if the task is still scheduled
+    bool isScheduled(int8_t id);
+
+    /// @brief Sets the function called when no task is due (set to nullptr to disable)
+    void setIdleHook(IdleHook hook);
+
+    /// @brief Returns the time until the next task is due (zero if a task is due or none is scheduled)
+    Time untilNext();
+
+    /// @brief Runs all tasks that are due, or the idle hook if none is
+    /// @return Returns the number of tasks that ran
+    uint8_t poll();
+    /// @brief Polls the scheduler forever
+    void run();
+
+private:
+    typedef struct Task
+    {
+        ticks_t deadline;
+        ticks_t period;
+        TaskCallback callback;
+        void *context;
+        /// @brief Position of the task in the heap (-1 if the slot is free)
+        int8_t heapIndex;
+    } Task;
+
+    int8_t schedule(ticks_t delay, ticks_t period, TaskCallback callback, void *context);
+    void push(uint8_t slot);
+    void remove(uint8_t heapIndex);
+    void siftUp(uint8_t heapIndex);
+    void siftDown(uint8_t heapIndex);
+    void swap(uint8_t a, uint8_t b);
+
+    Clock *clock;
+    IdleHook idleHook;
+    Task tasks[SCHEDULER_MAX_TASKS];
+    /// @brief Task slots ordered as a min-heap on their deadline
+    uint8_t heap[SCHEDULER_MAX_TASKS];
+    uint8_t heapSize;
+} Scheduler;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,245 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include "framework.h"
+#include "serialize.h"
+#include "constants.h"
+#include <string.h>
+
+// Message schemas: a message is declared once as an id, a data struct and the list of its fields,
+// the encoder, decoder and sizes are generated from the declaration.
+//
+// A field type provides:
+//   typedef ... type;                                   value type, stored in the data struct
+//   static constexpr uint8_t size(bool compact);        encoded size
+//   static bool fits(type value);                       true if the value can use the compact encoding
+//   static void encode(uint8_t *buf, type value, bool compact);
+//   static type decode(const uint8_t *buf, bool compact);
+
+/// @brief Field sent as a single byte
+struct ByteField
+{
+    typedef uint8_t type;
+    static constexpr uint8_t size(bool compact) { return 1; }
+    static bool fits(type value) { return true; }
+    static void encode(uint8_t *buf, type value, bool compact) { buf[0] = value; }
+    static type decode(const uint8_t *buf, bool compact) { return buf[0]; }
+};
+
+/// @brief Field always sent as a float
+struct FloatField
+{
+    typedef float type;
+    static constexpr uint8_t size(bool compact) { return 4; }
+    static bool fits(type value) { return true; }
+    static void encode(uint8_t *buf, type value, bool compact) { encodeFloat(buf, value); }
+    static type decode(const uint8_t *buf, bool compact) { return decodeFloat(buf); }
+};
+
+/// @brief Field sent as a float, or as a scaled int16 in the compact encoding
+/// @tparam Scale Type with a static float value() returning the wire scale (serialize.h)
+template <typename Scale>
+struct ScaledField
+{
+    typedef float type;
+    static constexpr uint8_t size(bool compact) { return compact ? 2 : 4; }
+    static bool fits(type value) { return fitsWire(value, Scale::value()); }
+
+    static void encode(uint8_t *buf, type value, bool compact)
+    {
+        if (compact)
+            encodeInt16(buf, toWire(value, Scale::value()));
+        else
+            encodeFloat(buf, value);
+    }
+
+    static type decode(const uint8_t *buf, bool compact)
+    {
+        return compact ? fromWire(decodeInt16(buf), Scale::value()) : decodeFloat(buf);
+    }
+};
+
+/// @brief Angle sent as a float, or in binary radians in the compact encoding
+struct AngleField
+{
+    typedef float type;
+    static constexpr uint8_t size(bool compact) { return compact ? 2 : 4; }
+    // binary radians wrap around, so only angles of less than half a revolution are sent compact
+    static bool fits(type value) { return fabs(value) < (float)M_PI; }
+
+    static void encode(uint8_t *buf, type value, bool compact)
+    {
+        if (compact)
+            encodeInt16(buf, angleToWire(value));
+        else
+            encodeFloat(buf, value);
+    }
+
+    static type decode(const uint8_t *buf, bool compact)
+    {
+        return compact ? angleFromWire(decodeInt16(buf)) : decodeFloat(buf);
+    }
+};
+
+struct SpeedScale
+{
+    static constexpr float value() { return WIRE_SPEED_SCALE; }
+};
+
+struct DistanceScale
+{
+    static constexpr float value() { return WIRE_DISTANCE_SCALE; }
+};
+
+/// @brief Encodes and decodes a list of fields stored one after another in a packed data struct
+template <typename... Fields>
+struct FieldList;
+
+template <>
+struct FieldList<>
+{
+    static constexpr uint8_t size(bool compact) { return 0; }
+    static constexpr uint8_t storage() { return 0; }
+    static constexpr bool hasCompact() { return false; }
+    static bool fits(const uint8_t *data) { return true; }
+    static void encode(uint8_t *buf, const uint8_t *data, bool compact) {}
+    static void decode(const uint8_t *buf, uint8_t *data, bool compact) {}
+};
+
+template <typename Field, typename... Rest>
+struct FieldList<Field, Rest...>
+{
+    typedef typename Field::type type;
+    typedef FieldList<Rest...> rest;
+
+    static constexpr uint8_t size(bool compact) { return Field::size(compact) + rest::size(compact); }
+    static constexpr uint8_t storage() { return sizeof(type) + rest::storage(); }
+    static constexpr bool hasCompact() { return Field::size(true) != Field::size(false) || rest::hasCompact(); }
+
+    static bool fits(const uint8_t *data)
+    {
+        type value;
+        memcpy(&value, data, sizeof(type));
+        return Field::fits(value) && rest::fits(data + sizeof(type));
+    }
+
+    static void encode(uint8_t *buf, const uint8_t *data, bool compact)
+    {
+        type value;
+        memcpy(&value, data, sizeof(type));
+        Field::encode(buf, value, compact);
+        rest::encode(buf + Field::size(compact), data + sizeof(type), compact);
+    }
+
+    static void decode(const uint8_t *buf, uint8_t *data, bool compact)
+    {
+        type value = Field::decode(buf, compact);
+        memcpy(data, &value, sizeof(type));
+        rest::decode(buf + Field::size(compact), data + sizeof(type), compact);
+    }
+};
+
+/// @brief Empty data struct of a message without fields
+typedef struct NoData
+{
+} NoData;
+
+/// @brief A message on the wire: [id | CMD_COMPACT][fields]
+/// @tparam Id The message id
+/// @tparam T Packed data struct holding the field values in the order of the fields
+/// @tparam Fields The field types
+template <uint8_t Id, typename T, typename... Fields>
+struct MessageDef
+{
+    typedef T Data;
+    typedef FieldList<Fields...> fields;
+
+    static_assert(fields::storage() == 0 || sizeof(T) == fields::storage(),
+                  "the data struct must be packed and hold the field values in order");
+    static_assert((Id & CMD_COMPACT) == 0, "the top bit of a message id marks the compact encoding");
+
+    static constexpr uint8_t id() { return Id; }
+
+    /// @brief Returns the size of the fields, without the id
+    static constexpr uint8_t size(bool compact) { return fields::size(compact); }
+
+    /// @brief Returns the largest encoded size, including the id
+    static constexpr uint8_t maxSize() { return 1 + fields::size(false); }
+
+    /// @brief Encodes the message, the compact encoding is only used if every value fits
+    /// @param buf Output buffer of at least maxSize() bytes
+    /// @return Returns the number of bytes written
+    static uint8_t encode(uint8_t *buf, const Data &data, bool compact)
+    {
+        compact = compact && fields::hasCompact() && fields::fits((const uint8_t *)&data);
+        buf[0] = compact ? (Id | CMD_COMPACT) : Id;
+        fields::encode(buf + 1, (const uint8_t *)&data, compact);
+        return 1 + size(compact);
+    }
+
+    /// @brief Decodes the fields following the id
+    /// @param buf Input buffer of size(compact) bytes
+    static void decode(const uint8_t *buf, bool compact, Data *data)
+    {
+        fields::decode(buf, (uint8_t *)data, compact);
+    }
+};
+
+/// @brief Returns the largest encoded size of the messages
+template <typename Message>
+constexpr uint8_t maxMessageSize()
+{
+    return Message::maxSize();
+}
+
+template <typename Message, typename Next, typename... Rest>
+constexpr uint8_t maxMessageSize()
+{
+    return Message::maxSize() > maxMessageSize<Next, Rest...>() ? Message::maxSize() : maxMessageSize<Next, Rest...>();
+}
+
+/// @brief Entry of a dispatch table decoding messages into a member of Target
+template <typename Target>
+struct MessageEntry
+{
+    uint8_t id;
+    /// @brief Size of the fields in the full encoding
+    uint8_t size;
+    /// @brief Size of the fields in the compact encoding
+    uint8_t compactSize;
+    void (*decode)(const uint8_t *buf, bool compact, Target *target);
+};
+
+template <typename Target, typename Message, typename Message::Data Target::*Member>
+void decodeMessage(const uint8_t *buf, bool compact, Target *target)
+{
+    Message::decode(buf, compact, &(target->*Member));
+}
+
+/// @brief Creates the dispatch table entry of a message decoded into target->*Member
+template <typename Target, typename Message, typename Message::Data Target::*Member>
+constexpr MessageEntry<Target> messageEntry()
+{
+    return {Message::id(), Message::size(false), Message::size(true), decodeMessage<Target, Message, Member>};
+}
+
+template <typename Target>
+void decodeNothing(const uint8_t *buf, bool compact, Target *target)
+{
+}
+
+/// @brief Creates the dispatch table entry of a message without fields
+template <typename Target, typename Message>
+constexpr MessageEntry<Target> messageEntry()
+{
+    return {Message::id(), Message::size(false), Message::size(true), decodeNothing<Target>};
+}
+
+/// @brief Returns true if the entry at index i has id i + 1, so the table can be indexed by id
+template <typename Target>
+constexpr bool isIndexedById(const MessageEntry<Target> *table, uint8_t count, uint8_t i = 0)
+{
+    return i >= count || (table[i].id == i + 1 && isIndexedById(table, count, i + 1));
+}
+
+#endif
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include "serialterminal.h"
+#include "clock.h"
 
 Version::Version(uint32_t version)
 {
@@ -150,4 +151,29 @@ void DebugInterface::array(uint8_t *buf, int size)
     }
     printf_P(PSTR("]\n"));
     SerialTerminal::setForegroundColor(TerminalColor::Default);
+}
+
+void DebugInterface::logFrame(LogLevel level, uint16_t id, const uint8_t *args, uint8_t size)
+{
+    uint32_t timestamp = (uint32_t)Clock::millis();
+
+    uint8_t frame[LOG_FRAME_HEADER_SIZE + LOG_MAX_ARGS_SIZE + 2];
+    frame[0] = LOG_FRAME_SYNC;
+    frame[1] = LOG_FRAME_HEADER_SIZE + size;
+    frame[2] = (uint8_t)level;
+    frame[3] = id & 0xFF;
+    frame[4] = id >> 8;
+    frame[5] = timestamp & 0xFF;
+    frame[6] = (timestamp >> 8) & 0xFF;
+    frame[7] = (timestamp >> 16) & 0xFF;
+    frame[8] = timestamp >> 24;
+    memcpy(frame + 2 + LOG_FRAME_HEADER_SIZE, args, size);
+
+    uint8_t length = 2 + LOG_FRAME_HEADER_SIZE + size;
+    uint8_t sum = 0;
+    for (uint8_t i = 1; i < length; i++)
+        sum += frame[i];
+    frame[length++] = -sum;
+
+    USART::write(frame, length);
 }
\ No newline at end of file
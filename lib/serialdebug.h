@@ -2,6 +2,16 @@
 #define SERIAL_DEBUG_H
 
 #include "framework.h"
+#include "logformat.h"
+#include <string.h>
+
+/**
+ * Set to 1 to send the DEBUG_INFO/WARN/ERROR messages as binary log frames
+ * (decoded on the host with tools/logdecoder and the table generated by autogen.py)
+ */
+#ifndef DEBUG_BINARY_LOG
+#define DEBUG_BINARY_LOG 0
+#endif
 
 typedef struct Version
 {
@@ -12,6 +22,50 @@ typedef struct Version
     uint8_t build;
 } Version;
 
+/// @brief Collects the raw bytes of binary log arguments
+typedef struct LogArgs
+{
+public:
+    LogArgs() : size(0) {}
+
+    void put(bool value) { put((int)value); }
+    void put(char value) { put((int)value); }
+    void put(signed char value) { put((int)value); }
+    void put(unsigned char value) { put((int)value); }
+    void put(short value) { put((int)value); }
+    void put(unsigned short value) { put((int)value); }
+    void put(double value) { put((float)value); }
+    void put(char *value) { put((const char *)value); }
+    /// @brief Appends the string and a single NUL, a string cut off to the space left keeps its terminator
+    void put(const char *value)
+    {
+        if (size >= LOG_MAX_ARGS_SIZE)
+            return;
+        uint8_t length = strnlen(value, LOG_MAX_ARGS_SIZE - size - 1);
+        append(value, length);
+        data[size++] = 0;
+    }
+
+    /// @brief Appends the raw bytes of any other argument type
+    template <typename T>
+    void put(T value)
+    {
+        append(&value, sizeof(T));
+    }
+
+    uint8_t data[LOG_MAX_ARGS_SIZE];
+    uint8_t size;
+
+private:
+    void append(const void *value, uint8_t length)
+    {
+        if (length > LOG_MAX_ARGS_SIZE - size)
+            length = LOG_MAX_ARGS_SIZE - size;
+        memcpy(data + size, value, length);
+        size += length;
+    }
+} LogArgs;
+
 typedef struct DebugInterface
 {
 public:
@@ -27,11 +81,43 @@ public:
     void error_P(const char *__fmt, ...);
     void array(uint8_t *buf, int size);
 
+    /// @brief Sends a binary log frame, use the DEBUG_INFO/WARN/ERROR macros instead of calling this directly
+    template <typename... Args>
+    void log(LogLevel level, uint16_t id, Args... args)
+    {
+        LogArgs data;
+        int expand[] = {0, (data.put(args), 0)...};
+        (void)expand;
+        logFrame(level, id, data.data, data.size);
+    }
+
+    /// @brief Sends a binary log frame with already encoded arguments
+    void logFrame(LogLevel level, uint16_t id, const uint8_t *args, uint8_t size);
+
 private:
     const char *name;
     Version version;
 } DebugInterface;
 
+/// @brief Compile time ID of a log format string
+template <uint16_t Id>
+struct LogId
+{
+    static constexpr uint16_t value = Id;
+};
+
+// Log macros, each call site is identified by its format string (a string literal).
+// The format string must not use %S, program memory strings can not be sent in binary mode.
+#if DEBUG_BINARY_LOG
+#define DEBUG_INFO(fmt, ...) debug.log(LogLevel::Info, LogId<logId(fmt)>::value, ##__VA_ARGS__)
+#define DEBUG_WARN(fmt, ...) debug.log(LogLevel::Warn, LogId<logId(fmt)>::value, ##__VA_ARGS__)
+#define DEBUG_ERROR(fmt, ...) debug.log(LogLevel::Error, LogId<logId(fmt)>::value, ##__VA_ARGS__)
+#else
+#define DEBUG_INFO(fmt, ...) debug.info_P(PSTR(fmt), ##__VA_ARGS__)
+#define DEBUG_WARN(fmt, ...) debug.warn_P(PSTR(fmt), ##__VA_ARGS__)
+#define DEBUG_ERROR(fmt, ...) debug.error_P(PSTR(fmt), ##__VA_ARGS__)
+#endif
+
 #include "../include/version.h"
 
 #define CURRENT_VERSION \
@@ -1,4 +1,5 @@
 #include "serialize.h"
+#include <util/crc16.h>
 
 void reverse(char *str, int len)
 {
@@ -22,10 +23,8 @@ int intToStr(int x, char *str, int str_size, int d)
     int i = 0;
     do
     {
-        printf("%i/%i\n", i, str_size);
         if (i < str_size)
         {
-            printf("si:%i\n", i);
             str[i++] = (x % 10) + '0';
         }
         x = x / 10;
@@ -37,7 +36,6 @@ int intToStr(int x, char *str, int str_size, int d)
     {
         if (i < str_size)
         {
-            printf("si2:%i\n", i);
             str[i++] = '0';
         }
     }
@@ -63,13 +61,10 @@ void ftoa(float n, char *res, int res_size, int afterpoint)
 
     // Extract integer part
     int ipart = (int)n;
-    printf("i:%i\n", ipart);
     // Extract floating part
     float fpart = n - (float)ipart;
-    printf("fpart\n");
     // convert integer part to string
     int i = intToStr(ipart, res, res_size, 0);
-    printf("is:%i\n", i);
     // check for display option after point
     if (afterpoint != 0)
     {
@@ -112,7 +107,72 @@ void encodeFloat(uint8_t *buf, float f)
     buf[3] = (fuint(f).i >> 24) & 0xFF;
 }
 
-float decodeFloat(uint8_t *buf)
+float decodeFloat(const uint8_t *buf)
 {
     return fuint(((uint32_t)buf[0]) | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24)).f;
+}
+
+int16_t toWire(float value, float scale)
+{
+    float scaled = value * scale;
+    if (scaled >= 32767.0f)
+        return 32767;
+    if (scaled <= -32768.0f)
+        return -32768;
+    return (int16_t)(scaled + (scaled >= 0.0f ? 0.5f : -0.5f));
+}
+
+float fromWire(int16_t value, float scale)
+{
+    return (float)value / scale;
+}
+
+bool fitsWire(float value, float scale)
+{
+    float scaled = value * scale;
+    return scaled < 32767.5f && scaled > -32768.5f;
+}
+
+int16_t angleToWire(float radians)
+{
+    // reduce to one turn first so the integer conversion can not overflow
+    float turns = radians * (float)(0.5 / M_PI);
+    turns -= floorf(turns);
+    return (int16_t)(uint16_t)(int32_t)(turns * 65536.0f + 0.5f);
+}
+
+float angleFromWire(int16_t value)
+{
+    return (float)value * (float)(M_PI / 32768.0);
+}
+
+void encodeInt16(uint8_t *buf, int16_t value)
+{
+    buf[0] = (uint16_t)value & 0xFF;
+    buf[1] = (uint16_t)value >> 8;
+}
+
+int16_t decodeInt16(const uint8_t *buf)
+{
+    return (int16_t)((uint16_t)buf[0] | ((uint16_t)buf[1] << 8));
+}
+
+uint8_t crc8(const uint8_t *data, uint8_t length)
+{
+    uint8_t crc = 0;
+    for (uint8_t i = 0; i < length; i++)
+    {
+        crc = _crc8_ccitt_update(crc, data[i]);
+    }
+    return crc;
+}
+
+uint16_t crc16(const uint8_t *data, uint8_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < length; i++)
+    {
+        crc = _crc_xmodem_update(crc, data[i]);
+    }
+    return crc;
 }
\ No newline at end of file
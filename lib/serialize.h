@@ -2,9 +2,32 @@
 #define SERIALIZE_H_
 
 #include "framework.h"
+#include "wireformat.h"
+#include <math.h>
 
 void ftoa(float n, char *res, int res_size, int afterpoint);
 void encodeFloat(uint8_t *buf, float f);
-float decodeFloat(uint8_t *buf);
+float decodeFloat(const uint8_t *buf);
+
+// Scales of the compact wire encoding are in wireformat.h
+
+/// @brief Converts a value into its scaled wire representation (saturates)
+int16_t toWire(float value, float scale);
+/// @brief Converts a scaled wire value back into a float
+float fromWire(int16_t value, float scale);
+/// @brief Returns true if the value fits into the scaled wire representation
+bool fitsWire(float value, float scale);
+/// @brief Converts an angle in radians into binary radians (wraps around)
+int16_t angleToWire(float radians);
+/// @brief Converts binary radians into an angle in radians in [-pi, pi)
+float angleFromWire(int16_t value);
+
+void encodeInt16(uint8_t *buf, int16_t value);
+int16_t decodeInt16(const uint8_t *buf);
+
+/// @brief Calculates the CRC-8 (polynomial 0x07, initial value 0) of a buffer
+uint8_t crc8(const uint8_t *data, uint8_t length);
+/// @brief Calculates the CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF) of a buffer
+uint16_t crc16(const uint8_t *data, uint8_t length);
 
 #endif
\ No newline at end of file
@@ -9,169 +9,169 @@ void escape()
 
 void SerialTerminal::bell()
 {
-    printf("\a");
+    printf_P(PSTR("\a"));
 }
 
 void SerialTerminal::homeCursor()
 {
     escape();
-    printf("[H");
+    printf_P(PSTR("[H"));
 }
 void SerialTerminal::moveCursor(int line, int column)
 {
     escape();
-    printf("[%i;%iH", line, column);
+    printf_P(PSTR("[%i;%iH"), line, column);
     escape();
-    printf("[%i;%if", line, column);
+    printf_P(PSTR("[%i;%if"), line, column);
 }
 void SerialTerminal::moveCursorUp(int num)
 {
     escape();
-    printf("[%iA", num);
+    printf_P(PSTR("[%iA"), num);
 }
 void SerialTerminal::moveCursorDown(int num)
 {
     escape();
-    printf("[%iB", num);
+    printf_P(PSTR("[%iB"), num);
 }
 void SerialTerminal::moveCursorRight(int num)
 {
     escape();
-    printf("[%iC", num);
+    printf_P(PSTR("[%iC"), num);
 }
 void SerialTerminal::moveCursorLeft(int num)
 {
     escape();
-    printf("[%iD", num);
+    printf_P(PSTR("[%iD"), num);
 }
 void SerialTerminal::moveCursorToNextLine(int linesDown)
 {
     escape();
-    printf("[%iE", linesDown);
+    printf_P(PSTR("[%iE"), linesDown);
 }
 void SerialTerminal::moveCursorToPrevLine(int linesUp)
 {
     escape();
-    printf("[%iF", linesUp);
+    printf_P(PSTR("[%iF"), linesUp);
 }
 void SerialTerminal::moveCursorToColumn(int column)
 {
     escape();
-    printf("[%iG", column);
+    printf_P(PSTR("[%iG"), column);
 }
 void SerialTerminal::moveCursorLineUp()
 {
     escape();
-    printf(" M");
+    printf_P(PSTR(" M"));
 }
 
 void SerialTerminal::eraseFromCursorEndScreen()
 {
     escape();
-    printf("[0J");
+    printf_P(PSTR("[0J"));
 }
 void SerialTerminal::eraseFromCursorBeginningScreen()
 {
     escape();
-    printf("[1J");
+    printf_P(PSTR("[1J"));
 }
 void SerialTerminal::eraseScreen()
 {
     escape();
-    printf("[2J");
+    printf_P(PSTR("[2J"));
 }
 void SerialTerminal::eraseFromCursorEndLine()
 {
     escape();
-    printf("[0K");
+    printf_P(PSTR("[0K"));
 }
 void SerialTerminal::eraseFromCursorStartLine()
 {
     escape();
-    printf("[1K");
+    printf_P(PSTR("[1K"));
 }
 void SerialTerminal::eraseLine()
 {
     escape();
-    printf("[2K");
+    printf_P(PSTR("[2K"));
 }
 
 void SerialTerminal::resetMode()
 {
     escape();
-    printf("[0m");
+    printf_P(PSTR("[0m"));
 }
 void SerialTerminal::boldMode(bool enabled)
 {
     escape();
     if (enabled)
-        printf("[1m");
+        printf_P(PSTR("[1m"));
     else
-        printf("[22m");
+        printf_P(PSTR("[22m"));
 }
 void SerialTerminal::dimMode(bool enabled)
 {
     escape();
     if (enabled)
-        printf("[2m");
+        printf_P(PSTR("[2m"));
     else
-        printf("[22m");
+        printf_P(PSTR("[22m"));
 }
 void SerialTerminal::italicMode(bool enabled)
 {
     escape();
     if (enabled)
-        printf("[3m");
+        printf_P(PSTR("[3m"));
     else
-        printf("[23m");
+        printf_P(PSTR("[23m"));
 }
 void SerialTerminal::underlineMode(bool enabled)
 {
     escape();
     if (enabled)
-        printf("[4m");
+        printf_P(PSTR("[4m"));
     else
-        printf("[24m");
+        printf_P(PSTR("[24m"));
 }
 void SerialTerminal::doubleUnderlineMode(bool enabled)
 {
     escape();
     if (enabled)
-        printf("[21m");
+        printf_P(PSTR("[21m"));
     else
-        printf("[24m");
+        printf_P(PSTR("[24m"));
 }
 void SerialTerminal::blinkingMode(bool enabled)
 {
     escape();
     if (enabled)
-        printf("[5m");
+        printf_P(PSTR("[5m"));
     else
-        printf("[25m");
+        printf_P(PSTR("[25m"));
 }
 void SerialTerminal::inverseMode(bool enabled)
 {
     escape();
     if (enabled)
-        printf("[7m");
+        printf_P(PSTR("[7m"));
     else
-        printf("[27m");
+        printf_P(PSTR("[27m"));
 }
 void SerialTerminal::invisibleMode(bool enabled)
 {
     escape();
     if (enabled)
-        printf("[8m");
+        printf_P(PSTR("[8m"));
     else
-        printf("[28m");
+        printf_P(PSTR("[28m"));
 }
 void SerialTerminal::strikethroughMode(bool enabled)
 {
     escape();
     if (enabled)
-        printf("[9m");
+        printf_P(PSTR("[9m"));
     else
-        printf("[29m");
+        printf_P(PSTR("[29m"));
 }
 
 void SerialTerminal::setForegroundColor(TerminalColor color)
@@ -180,55 +180,55 @@ void SerialTerminal::setForegroundColor(TerminalColor color)
     switch (color)
     {
     case TerminalColor::Black:
-        printf("[30m");
+        printf_P(PSTR("[30m"));
         break;
     case TerminalColor::Red:
-        printf("[31m");
+        printf_P(PSTR("[31m"));
         break;
     case TerminalColor::Green:
-        printf("[32m");
+        printf_P(PSTR("[32m"));
         break;
     case TerminalColor::Yellow:
-        printf("[33m");
+        printf_P(PSTR("[33m"));
         break;
     case TerminalColor::Blue:
-        printf("[34m");
+        printf_P(PSTR("[34m"));
         break;
     case TerminalColor::Magenta:
-        printf("[35m");
+        printf_P(PSTR("[35m"));
         break;
     case TerminalColor::Cyan:
-        printf("[36m");
+        printf_P(PSTR("[36m"));
         break;
     case TerminalColor::White:
-        printf("[37m");
+        printf_P(PSTR("[37m"));
         break;
     case TerminalColor::Default:
-        printf("[39m");
+        printf_P(PSTR("[39m"));
         break;
     case TerminalColor::BrightBlack:
-        printf("[90m");
+        printf_P(PSTR("[90m"));
         break;
     case TerminalColor::BrightRed:
-        printf("[91m");
+        printf_P(PSTR("[91m"));
         break;
     case TerminalColor::BrightGreen:
-        printf("[92m");
+        printf_P(PSTR("[92m"));
         break;
     case TerminalColor::BrightYellow:
-        printf("[93m");
+        printf_P(PSTR("[93m"));
         break;
     case TerminalColor::BrightBlue:
-        printf("[94m");
+        printf_P(PSTR("[94m"));
         break;
     case TerminalColor::BrightMagenta:
-        printf("[95m");
+        printf_P(PSTR("[95m"));
         break;
     case TerminalColor::BrightCyan:
-        printf("[96m");
+        printf_P(PSTR("[96m"));
         break;
     case TerminalColor::BrightWhite:
-        printf("[97m");
+        printf_P(PSTR("[97m"));
         break;
     }
 }
@@ -238,86 +238,86 @@ void SerialTerminal::setBackgroundColor(TerminalColor color)
     switch (color)
     {
     case TerminalColor::Black:
-        printf("[40m");
+        printf_P(PSTR("[40m"));
         break;
     case TerminalColor::Red:
-        printf("[41m");
+        printf_P(PSTR("[41m"));
         break;
     case TerminalColor::Green:
-        printf("[42m");
+        printf_P(PSTR("[42m"));
         break;
     case TerminalColor::Yellow:
-        printf("[43m");
+        printf_P(PSTR("[43m"));
         break;
     case TerminalColor::Blue:
-        printf("[44m");
+        printf_P(PSTR("[44m"));
         break;
     case TerminalColor::Magenta:
-        printf("[45m");
+        printf_P(PSTR("[45m"));
         break;
     case TerminalColor::Cyan:
-        printf("[46m");
+        printf_P(PSTR("[46m"));
         break;
     case TerminalColor::White:
-        printf("[47m");
+        printf_P(PSTR("[47m"));
         break;
     case TerminalColor::Default:
-        printf("[49m");
+        printf_P(PSTR("[49m"));
         break;
     case TerminalColor::BrightBlack:
-        printf("[100m");
+        printf_P(PSTR("[100m"));
         break;
     case TerminalColor::BrightRed:
-        printf("[101m");
+        printf_P(PSTR("[101m"));
         break;
     case TerminalColor::BrightGreen:
-        printf("[102m");
+        printf_P(PSTR("[102m"));
         break;
     case TerminalColor::BrightYellow:
-        printf("[103m");
+        printf_P(PSTR("[103m"));
         break;
     case TerminalColor::BrightBlue:
-        printf("[104m");
+        printf_P(PSTR("[104m"));
         break;
     case TerminalColor::BrightMagenta:
-        printf("[105m");
+        printf_P(PSTR("[105m"));
         break;
     case TerminalColor::BrightCyan:
-        printf("[106m");
+        printf_P(PSTR("[106m"));
         break;
     case TerminalColor::BrightWhite:
-        printf("[107m");
+        printf_P(PSTR("[107m"));
         break;
     }
 }
 void SerialTerminal::setForegroundColor(uint8_t color256)
 {
     escape();
-    printf("[38;5;%um", color256);
+    printf_P(PSTR("[38;5;%um"), color256);
 }
 void SerialTerminal::setBackgroundColor(uint8_t color256)
 {
     escape();
-    printf("[48;5;%um", color256);
+    printf_P(PSTR("[48;5;%um"), color256);
 }
 void SerialTerminal::setForegroundColor(uint8_t r, uint8_t g, uint8_t b)
 {
     escape();
-    printf("[38;2;%u;%u;%um", r, g, b);
+    printf_P(PSTR("[38;2;%u;%u;%um"), r, g, b);
 }
 void SerialTerminal::setBackgroundColor(uint8_t r, uint8_t g, uint8_t b)
 {
     escape();
-    printf("[48;2;%u;%u;%um", r, g, b);
+    printf_P(PSTR("[48;2;%u;%u;%um"), r, g, b);
 }
 
 void SerialTerminal::hideCursor()
 {
     escape();
-    printf("[?25l");
+    printf_P(PSTR("[?25l"));
 }
 void SerialTerminal::showCursor()
 {
     escape();
-    printf("[?25h");
+    printf_P(PSTR("[?25h"));
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include "framework.h"
+
+/// @brief Stream with its transport known at compile time, the backend calls are direct and can be inlined.
+/// Same interface as ByteStream, use ByteStream where the transport is only known at runtime.
+/// @tparam Backend Type with the static functions
+/// int put(uint8_t data), int get(bool last), int length(),
+/// int writeBlock(const uint8_t *data, int count) and int readBlock(uint8_t *buf, int count, bool last)
+template <typename Backend>
+struct Stream
+{
+public:
+    Stream()
+    {
+        pos = 0;
+    }
+
+    inline int length()
+    {
+        return Backend::length();
+    }
+
+    inline int position()
+    {
+        return pos;
+    }
+
+    inline int read()
+    {
+        pos++;
+        return Backend::get(true);
+    }
+
+    inline int read(uint8_t *buf, int offset, int count)
+    {
+        return read(buf, offset, count, false);
+    }
+
+    inline int read(uint8_t *buf, int offset, int count, bool leaveOpen)
+    {
+        int c = count > 0 ? Backend::readBlock(buf + offset, count, !leaveOpen) : 0;
+        pos += c;
+        return c;
+    }
+
+    inline int write(uint8_t data)
+    {
+        pos++;
+        return Backend::put(data);
+    }
+
+    inline int write(const uint8_t *data, int offset, int count)
+    {
+        int c = count > 0 ? Backend::writeBlock(data + offset, count) : 0;
+        pos += c;
+        return c;
+    }
+
+private:
+    int pos; /* bytes read or written so far */
+};
+
+#endif
\ No newline at end of file
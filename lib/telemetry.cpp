@@ -0,0 +1,108 @@
+#include "telemetry.h"
+#include "serialize.h"
+#include <stddef.h>
+
+#define TELEMETRY_CRC_SIZE (sizeof(TelemetryFrame) - 1)
+#define COMPACT_TELEMETRY_CRC_SIZE (sizeof(CompactTelemetryFrame) - 1)
+
+static_assert(offsetof(DrivetrainTelemetry, acceptedSequence) == sizeof(DrivetrainTelemetry) - TELEMETRY_SEQUENCE_SIZE &&
+                  offsetof(CompactDrivetrainTelemetry, acceptedSequence) == sizeof(CompactDrivetrainTelemetry) - TELEMETRY_SEQUENCE_SIZE,
+              "the sequence numbers must end the telemetry payloads, the unsequenced layouts are the rest");
+
+// Checks a frame of an unsequenced layout, its CRC follows the shorter payload
+static bool isValidUnsequencedFrame(const uint8_t *frame, uint8_t version, uint8_t payloadSize)
+{
+    uint8_t length = payloadSize - TELEMETRY_SEQUENCE_SIZE;
+    return frame[0] == version &&
+           frame[1] == length &&
+           frame[2 + length] == crc8(frame, 2 + length);
+}
+
+void TelemetryFrame::seal()
+{
+    version = TELEMETRY_VERSION;
+    length = sizeof(DrivetrainTelemetry);
+    crc = crc8((uint8_t *)this, TELEMETRY_CRC_SIZE);
+}
+
+bool TelemetryFrame::isValid()
+{
+    return version == TELEMETRY_VERSION &&
+           length == sizeof(DrivetrainTelemetry) &&
+           crc == crc8((uint8_t *)this, TELEMETRY_CRC_SIZE);
+}
+
+bool TelemetryFrame::isValidUnsequenced()
+{
+    return isValidUnsequencedFrame((uint8_t *)this, TELEMETRY_VERSION_UNSEQUENCED, sizeof(DrivetrainTelemetry));
+}
+
+void CompactDrivetrainTelemetry::pack(const DrivetrainTelemetry &telemetry)
+{
+    frontLeftSpeed = toWire(telemetry.frontLeftSpeed, WIRE_SPEED_SCALE);
+    frontRightSpeed = toWire(telemetry.frontRightSpeed, WIRE_SPEED_SCALE);
+    centerLeftSpeed = toWire(telemetry.centerLeftSpeed, WIRE_SPEED_SCALE);
+    centerRightSpeed = toWire(telemetry.centerRightSpeed, WIRE_SPEED_SCALE);
+    backLeftSpeed = toWire(telemetry.backLeftSpeed, WIRE_SPEED_SCALE);
+    backRightSpeed = toWire(telemetry.backRightSpeed, WIRE_SPEED_SCALE);
+    commandId = telemetry.commandId;
+    leftPower = toWire(telemetry.leftPower, WIRE_POWER_SCALE);
+    rightPower = toWire(telemetry.rightPower, WIRE_POWER_SCALE);
+    angle = angleToWire(telemetry.angle);
+    acceptedSequence = telemetry.acceptedSequence;
+    completedSequence = telemetry.completedSequence;
+    rejectedSequence = telemetry.rejectedSequence;
+}
+
+void CompactDrivetrainTelemetry::unpack(DrivetrainTelemetry *telemetry)
+{
+    telemetry->frontLeftSpeed = fromWire(frontLeftSpeed, WIRE_SPEED_SCALE);
+    telemetry->frontRightSpeed = fromWire(frontRightSpeed, WIRE_SPEED_SCALE);
+    telemetry->centerLeftSpeed = fromWire(centerLeftSpeed, WIRE_SPEED_SCALE);
+    telemetry->centerRightSpeed = fromWire(centerRightSpeed, WIRE_SPEED_SCALE);
+    telemetry->backLeftSpeed = fromWire(backLeftSpeed, WIRE_SPEED_SCALE);
+    telemetry->backRightSpeed = fromWire(backRightSpeed, WIRE_SPEED_SCALE);
+    telemetry->commandId = commandId;
+    telemetry->leftPower = fromWire(leftPower, WIRE_POWER_SCALE);
+    telemetry->rightPower = fromWire(rightPower, WIRE_POWER_SCALE);
+    telemetry->angle = angleFromWire(angle);
+    telemetry->acceptedSequence = acceptedSequence;
+    telemetry->completedSequence = completedSequence;
+    telemetry->rejectedSequence = rejectedSequence;
+}
+
+void CompactDrivetrainTelemetry::toRecord(TelemetryRecord *record)
+{
+    record->fields[TELEMETRY_FRONT_LEFT_SPEED] = frontLeftSpeed;
+    record->fields[TELEMETRY_FRONT_RIGHT_SPEED] = frontRightSpeed;
+    record->fields[TELEMETRY_CENTER_LEFT_SPEED] = centerLeftSpeed;
+    record->fields[TELEMETRY_CENTER_RIGHT_SPEED] = centerRightSpeed;
+    record->fields[TELEMETRY_BACK_LEFT_SPEED] = backLeftSpeed;
+    record->fields[TELEMETRY_BACK_RIGHT_SPEED] = backRightSpeed;
+    record->fields[TELEMETRY_COMMAND_ID] = commandId;
+    record->fields[TELEMETRY_LEFT_POWER] = leftPower;
+    record->fields[TELEMETRY_RIGHT_POWER] = rightPower;
+    record->fields[TELEMETRY_ANGLE] = angle;
+    record->fields[TELEMETRY_ACCEPTED_SEQUENCE] = acceptedSequence;
+    record->fields[TELEMETRY_COMPLETED_SEQUENCE] = completedSequence;
+    record->fields[TELEMETRY_REJECTED_SEQUENCE] = rejectedSequence;
+}
+
+void CompactTelemetryFrame::seal()
+{
+    version = TELEMETRY_VERSION_COMPACT;
+    length = sizeof(CompactDrivetrainTelemetry);
+    crc = crc8((uint8_t *)this, COMPACT_TELEMETRY_CRC_SIZE);
+}
+
+bool CompactTelemetryFrame::isValid()
+{
+    return version == TELEMETRY_VERSION_COMPACT &&
+           length == sizeof(CompactDrivetrainTelemetry) &&
+           crc == crc8((uint8_t *)this, COMPACT_TELEMETRY_CRC_SIZE);
+}
+
+bool CompactTelemetryFrame::isValidUnsequenced()
+{
+    return isValidUnsequencedFrame((uint8_t *)this, TELEMETRY_VERSION_COMPACT_UNSEQUENCED, sizeof(CompactDrivetrainTelemetry));
+}
\ No newline at end of file
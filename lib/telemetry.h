@@ -0,0 +1,101 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "framework.h"
+#include "telemetrycodec.h"
+
+/// @brief Version of the telemetry layout, bump it whenever DrivetrainTelemetry changes
+#define TELEMETRY_VERSION 3
+/// @brief Version of the compact telemetry layout, bump it whenever CompactDrivetrainTelemetry changes
+#define TELEMETRY_VERSION_COMPACT 4
+/// @brief Versions of the layouts before the sequence numbers, still sent by older drivetrains.
+/// Their payloads are the current ones without the sequence numbers at the end.
+#define TELEMETRY_VERSION_UNSEQUENCED 1
+#define TELEMETRY_VERSION_COMPACT_UNSEQUENCED 2
+/// @brief Size of the sequence numbers at the end of both payloads
+#define TELEMETRY_SEQUENCE_SIZE 3
+
+/// @brief Drivetrain state sent to the brain on every read
+typedef struct __attribute__((packed)) DrivetrainTelemetry
+{
+    float frontLeftSpeed;
+    float frontRightSpeed;
+    float centerLeftSpeed;
+    float centerRightSpeed;
+    float backLeftSpeed;
+    float backRightSpeed;
+    uint8_t commandId;
+    float leftPower;
+    float rightPower;
+    float angle;
+    /// @brief Sequence number of the last batched command added to the command queue
+    uint8_t acceptedSequence;
+    /// @brief Sequence number of the last batched command that finished
+    uint8_t completedSequence;
+    /// @brief Sequence number of the last batched command dropped because it was invalid or the command queue was full
+    uint8_t rejectedSequence;
+} DrivetrainTelemetry;
+
+/// @brief Telemetry as it is sent over I2C, read in a single transfer
+typedef struct __attribute__((packed)) TelemetryFrame
+{
+    uint8_t version;
+    /// @brief Size of the payload
+    uint8_t length;
+    DrivetrainTelemetry payload;
+    /// @brief CRC-8 of the version, length and payload
+    uint8_t crc;
+
+    /// @brief Fills in the version, length and CRC of the payload
+    void seal();
+    /// @brief Returns true if the frame has the current version and length and an intact CRC
+    bool isValid();
+    /// @brief Returns true if the frame is an intact frame of an older drivetrain (TELEMETRY_VERSION_UNSEQUENCED),
+    /// the sequence numbers of its payload are not part of it
+    bool isValidUnsequenced();
+} TelemetryFrame;
+
+/// @brief DrivetrainTelemetry in the compact wire encoding (scales in serialize.h)
+typedef struct __attribute__((packed)) CompactDrivetrainTelemetry
+{
+    int16_t frontLeftSpeed;
+    int16_t frontRightSpeed;
+    int16_t centerLeftSpeed;
+    int16_t centerRightSpeed;
+    int16_t backLeftSpeed;
+    int16_t backRightSpeed;
+    uint8_t commandId;
+    int16_t leftPower;
+    int16_t rightPower;
+    /// @brief Angle in binary radians
+    int16_t angle;
+    uint8_t acceptedSequence;
+    uint8_t completedSequence;
+    uint8_t rejectedSequence;
+
+    void pack(const DrivetrainTelemetry &telemetry);
+    void unpack(DrivetrainTelemetry *telemetry);
+    /// @brief Copies the fields into a record of the telemetry downlink
+    void toRecord(TelemetryRecord *record);
+} CompactDrivetrainTelemetry;
+
+/// @brief Compact telemetry as it is sent over I2C, the version byte tells it apart from a TelemetryFrame
+typedef struct __attribute__((packed)) CompactTelemetryFrame
+{
+    uint8_t version;
+    /// @brief Size of the payload
+    uint8_t length;
+    CompactDrivetrainTelemetry payload;
+    /// @brief CRC-8 of the version, length and payload
+    uint8_t crc;
+
+    /// @brief Fills in the version, length and CRC of the payload
+    void seal();
+    /// @brief Returns true if the frame has the current version and length and an intact CRC
+    bool isValid();
+    /// @brief Returns true if the frame is an intact frame of an older drivetrain (TELEMETRY_VERSION_COMPACT_UNSEQUENCED),
+    /// the sequence numbers of its payload are not part of it
+    bool isValidUnsequenced();
+} CompactTelemetryFrame;
+
+#endif
\ No newline at end of file
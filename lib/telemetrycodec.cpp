@@ -0,0 +1,191 @@
+#include "telemetrycodec.h"
+#include <string.h>
+
+#define HISTORY_MASK (TELEMETRY_HISTORY - 1)
+
+uint8_t encodeVarint(uint8_t *buf, int16_t value)
+{
+    // zig-zag keeps small negative values small: 0, -1, 1, -2 ... become 0, 1, 2, 3 ...
+    uint16_t zigzag = ((uint16_t)value << 1) ^ (uint16_t)(value >> 15);
+    uint8_t i = 0;
+    while (zigzag >= 0x80)
+    {
+        buf[i++] = (zigzag & 0x7F) | 0x80;
+        zigzag >>= 7;
+    }
+    buf[i++] = zigzag;
+    return i;
+}
+
+uint8_t decodeVarint(const uint8_t *buf, uint8_t length, int16_t *value)
+{
+    uint16_t zigzag = 0;
+    for (uint8_t i = 0; i < length && i < 3; i++)
+    {
+        zigzag |= (uint16_t)(buf[i] & 0x7F) << (7 * i);
+        if ((buf[i] & 0x80) == 0)
+        {
+            *value = (int16_t)((zigzag >> 1) ^ -(zigzag & 1));
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static void encodeField(uint8_t *buf, int16_t value)
+{
+    buf[0] = (uint16_t)value & 0xFF;
+    buf[1] = (uint16_t)value >> 8;
+}
+
+static int16_t decodeField(const uint8_t *buf)
+{
+    return (int16_t)((uint16_t)buf[0] | ((uint16_t)buf[1] << 8));
+}
+
+TelemetryEncoder::TelemetryEncoder()
+{
+    next = 0;
+    reset();
+}
+
+void TelemetryEncoder::reset()
+{
+    base = 0;
+    hasBase = false;
+    sinceKeyframe = 0;
+}
+
+void TelemetryEncoder::acknowledge(uint8_t number)
+{
+    // only records still in the history can be a base, and the base only moves forward
+    uint8_t age = next - number;
+    if (age == 0 || age > TELEMETRY_HISTORY)
+        return;
+    if (hasBase && (uint8_t)(number - base) >= 0x80)
+        return;
+
+    base = number;
+    hasBase = true;
+}
+
+uint8_t TelemetryEncoder::encode(const TelemetryRecord &record, uint8_t *buf)
+{
+    uint8_t number = next;
+    uint8_t size = 0;
+
+    // the slot of the new record must not be the one of the base
+    bool baseKept = hasBase && (uint8_t)(number - base) < TELEMETRY_HISTORY;
+    if (baseKept && sinceKeyframe < TELEMETRY_KEYFRAME_INTERVAL)
+        size = encodeDelta(record, buf);
+
+    if (size == 0)
+    {
+        buf[0] = TELEMETRY_KEYFRAME;
+        buf[1] = number;
+        for (uint8_t i = 0; i < TELEMETRY_FIELD_COUNT; i++)
+        {
+            encodeField(buf + 2 + 2 * i, record.fields[i]);
+        }
+        size = TELEMETRY_KEYFRAME_SIZE;
+        sinceKeyframe = 0;
+        // the receiver acknowledges the keyframe before deltas are sent against it
+        hasBase = baseKept;
+    }
+    sinceKeyframe++;
+
+    history[number & HISTORY_MASK] = record;
+    next++;
+    return size;
+}
+
+uint8_t TelemetryEncoder::encodeDelta(const TelemetryRecord &record, uint8_t *buf)
+{
+    const TelemetryRecord &reference = history[base & HISTORY_MASK];
+    uint16_t changed = 0;
+    uint8_t size = TELEMETRY_DELTA_HEADER_SIZE;
+    uint8_t value[3];
+
+    for (uint8_t i = 0; i < TELEMETRY_FIELD_COUNT; i++)
+    {
+        int16_t delta = (int16_t)(uint16_t)(record.fields[i] - reference.fields[i]);
+        if (delta == 0)
+            continue;
+
+        uint8_t length = encodeVarint(value, delta);
+        if (size + length >= TELEMETRY_KEYFRAME_SIZE)
+            return 0;
+        memcpy(buf + size, value, length);
+        size += length;
+        changed |= 1 << i;
+    }
+
+    buf[0] = 0;
+    buf[1] = next;
+    buf[2] = base;
+    buf[3] = changed & 0xFF;
+    buf[4] = changed >> 8;
+    return size;
+}
+
+TelemetryDecoder::TelemetryDecoder()
+{
+    for (uint8_t i = 0; i < TELEMETRY_HISTORY; i++)
+    {
+        valid[i] = false;
+    }
+    keyframe = false;
+}
+
+bool TelemetryDecoder::decode(const uint8_t *buf, uint8_t length, TelemetryRecord *record, uint8_t *number)
+{
+    if (length < 2)
+        return false;
+
+    if (buf[0] & TELEMETRY_KEYFRAME)
+    {
+        if (length != TELEMETRY_KEYFRAME_SIZE)
+            return false;
+        for (uint8_t i = 0; i < TELEMETRY_FIELD_COUNT; i++)
+        {
+            record->fields[i] = decodeField(buf + 2 + 2 * i);
+        }
+        keyframe = true;
+    }
+    else
+    {
+        if (length < TELEMETRY_DELTA_HEADER_SIZE)
+            return false;
+
+        uint8_t base = buf[2];
+        uint8_t slot = base & HISTORY_MASK;
+        if (!valid[slot] || numbers[slot] != base)
+            return false;
+
+        uint16_t changed = buf[3] | (buf[4] << 8);
+        uint8_t pos = TELEMETRY_DELTA_HEADER_SIZE;
+        *record = history[slot];
+        for (uint8_t i = 0; i < TELEMETRY_FIELD_COUNT; i++)
+        {
+            if ((changed & (1 << i)) == 0)
+                continue;
+
+            int16_t delta;
+            uint8_t read = decodeVarint(buf + pos, length - pos, &delta);
+            if (read == 0)
+                return false;
+            pos += read;
+            record->fields[i] = (int16_t)(uint16_t)(record->fields[i] + delta);
+        }
+        if (pos != length)
+            return false;
+        keyframe = false;
+    }
+
+    *number = buf[1];
+    uint8_t slot = *number & HISTORY_MASK;
+    history[slot] = *record;
+    numbers[slot] = *number;
+    valid[slot] = true;
+    return true;
+}
\ No newline at end of file
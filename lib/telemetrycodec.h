@@ -0,0 +1,121 @@
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <stdint.h>
+
+// Telemetry downlink encoding, shared by the firmware and the host decoder.
+//
+// A record is the compact telemetry (telemetry.h) as a list of integer fields. It is sent as
+//   keyframe = [TELEMETRY_KEYFRAME][number][field (int16, little endian)...]
+//   delta    = [0][number][base number][changed mask (2 bytes, little endian)][varint...]
+// where a delta holds the zig-zag varint of (field - base field) for every field with its bit set in the mask.
+// The base is the newest record the receiver acknowledged, the encoder sends a keyframe
+// when it has no acknowledged base, every TELEMETRY_KEYFRAME_INTERVAL records and when a delta would be larger.
+
+/// @brief Number of fields in a record
+#define TELEMETRY_FIELD_COUNT 13
+/// @brief Flag of a keyframe in the first byte
+#define TELEMETRY_KEYFRAME 0x80
+/// @brief Size of a keyframe, the largest encoding
+#define TELEMETRY_KEYFRAME_SIZE (2 + 2 * TELEMETRY_FIELD_COUNT)
+/// @brief Size of a delta without its values
+#define TELEMETRY_DELTA_HEADER_SIZE 5
+
+#ifndef TELEMETRY_KEYFRAME_INTERVAL
+/** Records between keyframes, they bound how long a lost acknowledgement or a decoder restart goes unnoticed */
+#define TELEMETRY_KEYFRAME_INTERVAL 10
+#endif
+
+#ifndef TELEMETRY_HISTORY
+/** Records kept by the encoder and decoder to find the base of a delta (power of two) */
+#define TELEMETRY_HISTORY 4
+#endif
+
+static_assert((TELEMETRY_HISTORY & (TELEMETRY_HISTORY - 1)) == 0, "TELEMETRY_HISTORY must be a power of two");
+static_assert(TELEMETRY_FIELD_COUNT <= 16, "the changed mask holds 16 fields");
+
+/// @brief Field indices, in the order of CompactDrivetrainTelemetry
+enum TelemetryField
+{
+    TELEMETRY_FRONT_LEFT_SPEED,
+    TELEMETRY_FRONT_RIGHT_SPEED,
+    TELEMETRY_CENTER_LEFT_SPEED,
+    TELEMETRY_CENTER_RIGHT_SPEED,
+    TELEMETRY_BACK_LEFT_SPEED,
+    TELEMETRY_BACK_RIGHT_SPEED,
+    TELEMETRY_COMMAND_ID,
+    TELEMETRY_LEFT_POWER,
+    TELEMETRY_RIGHT_POWER,
+    TELEMETRY_ANGLE,
+    TELEMETRY_ACCEPTED_SEQUENCE,
+    TELEMETRY_COMPLETED_SEQUENCE,
+    TELEMETRY_REJECTED_SEQUENCE
+};
+
+/// @brief Telemetry as integer fields (wire scales in serialize.h)
+typedef struct TelemetryRecord
+{
+    int16_t fields[TELEMETRY_FIELD_COUNT];
+} TelemetryRecord;
+
+/// @brief Writes the zig-zag varint of a value (1 to 3 bytes)
+/// @return Returns the number of bytes written
+uint8_t encodeVarint(uint8_t *buf, int16_t value);
+
+/// @brief Reads a zig-zag varint
+/// @return Returns the number of bytes read, 0 if the varint is longer than the buffer or malformed
+uint8_t decodeVarint(const uint8_t *buf, uint8_t length, int16_t *value);
+
+/// @brief Encodes records as keyframes or as deltas against the last acknowledged record
+typedef struct TelemetryEncoder
+{
+public:
+    TelemetryEncoder();
+
+    /// @brief Encodes the next record
+    /// @param buf Output buffer of TELEMETRY_KEYFRAME_SIZE bytes
+    /// @return Returns the number of bytes written
+    uint8_t encode(const TelemetryRecord &record, uint8_t *buf);
+
+    /// @brief Marks a record as received, later records are sent as deltas against it
+    void acknowledge(uint8_t number);
+
+    /// @brief Forgets the acknowledged record, the next record is a keyframe
+    void reset();
+
+private:
+    /// @return Returns the size of the delta or 0 if it is not smaller than a keyframe
+    uint8_t encodeDelta(const TelemetryRecord &record, uint8_t *buf);
+
+    TelemetryRecord history[TELEMETRY_HISTORY];
+    uint8_t next;
+    uint8_t base;
+    bool hasBase;
+    uint8_t sinceKeyframe;
+} TelemetryEncoder;
+
+/// @brief Decodes the records of a TelemetryEncoder
+typedef struct TelemetryDecoder
+{
+public:
+    TelemetryDecoder();
+
+    /// @brief Decodes a record
+    /// @param number The record number to acknowledge to the encoder
+    /// @return Returns false if the data is malformed or the base of a delta is unknown (waits for the next keyframe)
+    bool decode(const uint8_t *buf, uint8_t length, TelemetryRecord *record, uint8_t *number);
+
+    /// @brief Returns true if the last decoded record was a keyframe
+    inline bool isKeyframe()
+    {
+        return keyframe;
+    }
+
+private:
+    TelemetryRecord history[TELEMETRY_HISTORY];
+    uint8_t numbers[TELEMETRY_HISTORY];
+    bool valid[TELEMETRY_HISTORY];
+    bool keyframe;
+} TelemetryDecoder;
+
+#endif
\ No newline at end of file
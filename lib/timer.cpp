@@ -17,10 +17,9 @@ Time Timer::elapsed()
         return Time::fromTicks(c_end - c_start);
 }
 
-bool Timer::elapsed(Time &time)
+bool Timer::elapsed(const Time &time)
 {
-    Time t = elapsed();
-    return t.compareTo(time) >= 0;
+    return elapsed() >= time;
 }
 
 void Timer::stop()
@@ -60,14 +59,7 @@ bool Timer::running()
     return isRunning;
 }
 
-void Timer::spinWait(Time &time)
-{
-    restart();
-    while (!elapsed(time))
-        ;
-}
-
-void Timer::spinWait(Time time)
+void Timer::spinWait(const Time &time)
 {
     restart();
     while (!elapsed(time))
@@ -9,7 +9,7 @@ typedef struct Timer
 public:
     Timer(Clock *clock);
     Time elapsed();
-    bool elapsed(Time &time);
+    bool elapsed(const Time &time);
     void stop();
     void start();
     void restart();
@@ -18,13 +18,12 @@ public:
 
     /// @brief Performs a spin wait until the target time has elapsed
     /// @note This restarts the timer
-    void spinWait(Time time);
-    void spinWait(Time &time);
+    void spinWait(const Time &time);
 
 private:
     Clock *clock;
-    unsigned long c_start;
-    unsigned long c_end;
+    ticks_t c_start;
+    ticks_t c_end;
     bool isRunning;
 } Timer;
 
@@ -1,19 +1,83 @@
 #include "framework.h"
 #include "usart.h"
+#include "ringbuffer.h"
 
 #ifndef BAUD_TOL
 #define BAUD_TOL 2
 #endif
 
+static RingBuffer<uint8_t, USART_TX_BUFFER_SIZE> txBuffer;
+static RingBuffer<uint8_t, USART_RX_BUFFER_SIZE> rxBuffer;
+
+static USARTOverflowPolicy overflowPolicy = USARTOverflowPolicy::Block;
+
+ISR(USART_UDRE_vect)
+{
+    uint8_t data;
+    if (!txBuffer.pop(&data))
+    {
+        // nothing left to send
+        UCSR0B &= ~(1 << UDRIE0);
+        return;
+    }
+
+    UDR0 = data;
+}
+
+ISR(USART_RX_vect)
+{
+    // a full buffer counts the byte as an overflow
+    uint8_t data = UDR0;
+    rxBuffer.push(data);
+}
+
+/// @brief Sends the oldest queued byte by polling (only call with interrupts disabled)
+static void drainPolled()
+{
+    while (!(UCSR0A & (1 << UDRE0)))
+        ;
+
+    uint8_t data;
+    if (txBuffer.pop(&data))
+        UDR0 = data;
+}
+
+static void queue(uint8_t data)
+{
+    while (1)
+    {
+        // several contexts may log, so the single producer side is kept by disabling interrupts
+        uint8_t _SREG = SREG;
+        cli();
+
+        // in Drop mode the buffer counts the lost byte as an overflow
+        if (!txBuffer.isFull() || overflowPolicy == USARTOverflowPolicy::Drop)
+        {
+            if (txBuffer.push(data))
+                UCSR0B |= (1 << UDRIE0);
+
+            SREG = _SREG;
+            return;
+        }
+
+        // the interrupt can not run, so make room by hand
+        if (!(_SREG & (1 << SREG_I)))
+            drainPolled();
+
+        SREG = _SREG;
+    }
+}
+
 void USART::enable()
 {
     UCSR0A = 0;
-    UCSR0B = (1 << RXEN0) | (1 << TXEN0);   // enable TX/RX
-    UCSR0C = (1 << UCSZ00) | (1 << UCSZ01); // 8-bit data
+    UCSR0B = (1 << RXEN0) | (1 << TXEN0) | (1 << RXCIE0); // enable TX/RX and the receive interrupt
+    UCSR0C = (1 << UCSZ00) | (1 << UCSZ01);               // 8-bit data
 }
 
 void USART::disable()
 {
+    flush();
     UCSR0A = 0;
     UCSR0B = 0;
     UCSR0C = 0;
@@ -39,21 +103,64 @@ void USART::setBaudRate(unsigned long baud)
     UBRR0L = ubbr & 0xff;
 }
 
+void USART::put(uint8_t data)
+{
+    queue(data);
+}
+
 void USART::write(uint8_t *data, int count)
 {
     for (int i = 0; i < count; i++)
     {
-        while (!(UCSR0A & (1 << UDRE0)))
-            ;
+        queue(data[i]);
+    }
+}
 
-        UDR0 = data[i];
+void USART::flush()
+{
+    while (!txBuffer.isEmpty())
+    {
+        uint8_t _SREG = SREG;
+        cli();
+        if (!(_SREG & (1 << SREG_I)))
+            drainPolled();
+        SREG = _SREG;
     }
 }
 
+uint8_t USART::available()
+{
+    return rxBuffer.count();
+}
+
+int USART::read()
+{
+    uint8_t data;
+    if (!rxBuffer.pop(&data))
+        return -1;
+    return data;
+}
+
+void USART::setOverflowPolicy(USARTOverflowPolicy policy)
+{
+    overflowPolicy = policy;
+}
+
+USARTStats USART::getStats()
+{
+    USARTStats stats = {txBuffer.getOverflows(), txBuffer.getHighWaterMark(), rxBuffer.getOverflows()};
+    return stats;
+}
+
+void USART::resetStats()
+{
+    txBuffer.resetStats();
+    rxBuffer.resetStats();
+}
+
 int writeChar(char ch, __file *file __attribute__((unused)))
 {
-    uint8_t bt = (uint8_t)ch;
-    USART::write(&bt, 1);
+    queue((uint8_t)ch);
     return 1;
 }
 
@@ -2,6 +2,41 @@
 #define USART_H
 
 #include <stdint.h>
+#include "stream.h"
+
+/**
+ * Size of the transmit ring buffer in bytes (power of two, at most 256)
+ */
+#ifndef USART_TX_BUFFER_SIZE
+#define USART_TX_BUFFER_SIZE 128
+#endif
+
+/**
+ * Size of the receive ring buffer in bytes (power of two, at most 256)
+ */
+#ifndef USART_RX_BUFFER_SIZE
+#define USART_RX_BUFFER_SIZE 32
+#endif
+
+/// @brief What happens to a byte written while the transmit buffer is full
+enum class USARTOverflowPolicy
+{
+    /// @brief Wait until the interrupt has made room (falls back to polling when interrupts are disabled)
+    Block,
+    /// @brief Discard the byte and count it as dropped
+    Drop
+};
+
+/// @brief Buffer statistics
+typedef struct USARTStats
+{
+    /// @brief Number of bytes discarded because the transmit buffer was full
+    uint16_t droppedBytes;
+    /// @brief Highest number of bytes waiting in the transmit buffer
+    uint8_t highWaterMark;
+    /// @brief Number of received bytes lost because the receive buffer was full
+    uint16_t receiveOverflows;
+} USARTStats;
 
 namespace USART
 {
@@ -13,13 +48,72 @@ namespace USART
     /// @brief Sets the baud rate
     void setBaudRate(unsigned long baud);
 
-    /// @brief Wrties bytes from a buffer
+    /// @brief Queues a byte, it is sent by the data register empty interrupt
+    void put(uint8_t data);
+
+    /// @brief Queues bytes from a buffer, they are sent by the data register empty interrupt
     /// @param data Input buffer
     /// @param count Number of bytes to write
     void write(uint8_t *data, int count);
 
+    /// @brief Waits until all queued bytes have been handed to the transmitter
+    void flush();
+
+    /// @brief Returns the number of received bytes waiting in the receive buffer
+    uint8_t available();
+    /// @brief Reads a received byte
+    /// @return Returns the byte or -1 if none is available
+    int read();
+
+    /// @brief Sets what happens when the transmit buffer is full (defaults to Block)
+    void setOverflowPolicy(USARTOverflowPolicy policy);
+
+    /// @brief Returns a snapshot of the buffer statistics
+    USARTStats getStats();
+    /// @brief Clears the buffer statistics
+    void resetStats();
+
     /// @brief Creates a file stream and redirects stdout to the USART port (allows for printf)
     void redirectStdout();
 }
 
+/// @brief Stream backend for the USART port
+struct USARTBackend
+{
+    static inline int put(uint8_t data)
+    {
+        USART::put(data);
+        return 1;
+    }
+
+    static inline int get(bool last)
+    {
+        return USART::read();
+    }
+
+    static inline int length()
+    {
+        return USART::available();
+    }
+
+    static inline int writeBlock(const uint8_t *data, int count)
+    {
+        USART::write((uint8_t *)data, count);
+        return count;
+    }
+
+    static inline int readBlock(uint8_t *buf, int count, bool last)
+    {
+        int c = 0, d;
+        while (c < count && (d = USART::read()) >= 0)
+        {
+            buf[c++] = d;
+        }
+        return c;
+    }
+};
+
+/// @brief USART stream with direct calls into the USART buffers
+typedef Stream<USARTBackend> USARTStream;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <stdint.h>
+#include <math.h>
+
+// Packet framing of the radio link and scales of the compact integer encoding,
+// shared by the firmware and the host decoders.
+//
+// Packets on a byte stream (the radio link):
+//   frame   = COBS([type][sequence][length][payload...][crc16 low][crc16 high]) 0x00
+// COBS removes every 0x00 from the frame, so 0x00 only marks the end of a frame and the
+// receiver resynchronises on the next one after a corrupted or dropped byte.
+// The CRC-16/CCITT-FALSE (crc16() in serialize.h) covers the header and the payload.
+
+#ifndef PACKET_MAX_PAYLOAD
+/** Largest payload of a packet */
+#define PACKET_MAX_PAYLOAD 32
+#endif
+
+/// @brief Size of the packet header (type, sequence and length)
+#define PACKET_HEADER_SIZE 3
+/// @brief Size of the packet checksum
+#define PACKET_CRC_SIZE 2
+/// @brief Size of the largest packet before framing
+#define PACKET_MAX_SIZE (PACKET_HEADER_SIZE + PACKET_MAX_PAYLOAD + PACKET_CRC_SIZE)
+/// @brief Size of the largest framed packet (COBS code byte and delimiter)
+#define PACKET_MAX_FRAME_SIZE (PACKET_MAX_SIZE + 2)
+/// @brief Byte marking the end of a frame
+#define PACKET_DELIMITER 0x00
+
+// Scales of the compact wire encoding, values are sent as value * scale in an int16
+
+/// @brief Wire scale of wheel speeds and velocities (1/1000 units, range +-32.767)
+#define WIRE_SPEED_SCALE 1000.0f
+/// @brief Wire scale of motor powers (Q15, range [-1, 1])
+#define WIRE_POWER_SCALE 32767.0f
+/// @brief Wire scale of distances (1/1000 units, range +-32.767)
+#define WIRE_DISTANCE_SCALE 1000.0f
+/// @brief Wire scale of angles in binary radians (32768 is pi, angles wrap around)
+#define WIRE_ANGLE_SCALE (32768.0f / (float)M_PI)
+
+#endif
@@ -0,0 +1,262 @@
+// Host side decoder for the binary debug log (DEBUG_BINARY_LOG=1).
+//
+// Build: g++ -std=c++17 -O2 -I../../lib -o logdecoder logdecoder.cpp
+// Usage: logdecoder <include/logstrings.txt> [input]
+//
+// The input (a serial device configured with stty, a capture file, or stdin)
+// may mix text and binary frames, text is passed through unchanged.
+
+#include <logformat.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+#include <map>
+#include <string>
+
+static std::map<uint16_t, std::string> strings;
+static bool colors = false;
+
+static std::string unescape(const std::string &text)
+{
+    std::string out;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (text[i] == '\\' && i + 1 < text.size())
+        {
+            char c = text[++i];
+            out += c == 'n' ? '\n' : c == 'r' ? '\r'
+                                 : c == 't'   ? '\t'
+                                              : c;
+        }
+        else
+        {
+            out += text[i];
+        }
+    }
+    return out;
+}
+
+static bool loadStrings(const char *path)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos)
+            continue;
+        strings[(uint16_t)strtoul(line.substr(0, tab).c_str(), nullptr, 16)] = unescape(line.substr(tab + 1));
+    }
+    return true;
+}
+
+/// @brief Reads the little endian integer of the given size from the argument bytes
+static bool readInt(const uint8_t *&args, const uint8_t *end, size_t size, bool isSigned, long long &value)
+{
+    if ((size_t)(end - args) < size)
+        return false;
+
+    unsigned long long raw = 0;
+    for (size_t i = 0; i < size; i++)
+        raw |= (unsigned long long)args[i] << (8 * i);
+    args += size;
+
+    if (isSigned && size < 8 && (raw & (1ULL << (8 * size - 1))))
+        raw |= ~0ULL << (8 * size);
+    value = (long long)raw;
+    return true;
+}
+
+/// @brief Rebuilds the text of an avr-libc printf format from the raw argument bytes
+static std::string format(const std::string &fmt, const uint8_t *args, const uint8_t *end)
+{
+    std::string out;
+    char buf[256];
+
+    for (size_t i = 0; i < fmt.size(); i++)
+    {
+        if (fmt[i] != '%')
+        {
+            out += fmt[i];
+            continue;
+        }
+        if (i + 1 < fmt.size() && fmt[i + 1] == '%')
+        {
+            out += '%';
+            i++;
+            continue;
+        }
+
+        // flags, width and precision are passed on to the host printf
+        std::string spec = "%";
+        size_t j = i + 1;
+        while (j < fmt.size() && strchr("-+ #0123456789.", fmt[j]))
+            spec += fmt[j++];
+
+        // length modifier, int is 16 bits on the AVR
+        size_t size = 2;
+        while (j < fmt.size() && strchr("hl", fmt[j]))
+        {
+            if (fmt[j] == 'l')
+                size = size == 2 ? 4 : 8;
+            j++;
+        }
+        if (j >= fmt.size())
+            break;
+
+        char conversion = fmt[j];
+        i = j;
+
+        long long value;
+        switch (conversion)
+        {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'c':
+            if (!readInt(args, end, size, conversion == 'd' || conversion == 'i', value))
+                return out + "<truncated>\n";
+            spec += conversion == 'c' ? "c" : std::string("ll") + conversion;
+            if (conversion == 'c')
+                snprintf(buf, sizeof(buf), spec.c_str(), (int)value);
+            else
+                snprintf(buf, sizeof(buf), spec.c_str(), value);
+            out += buf;
+            break;
+        case 'p':
+            if (!readInt(args, end, 2, false, value))
+                return out + "<truncated>\n";
+            snprintf(buf, sizeof(buf), "0x%04llx", value);
+            out += buf;
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        {
+            float f;
+            if (end - args < (long)sizeof(f))
+                return out + "<truncated>\n";
+            memcpy(&f, args, sizeof(f));
+            args += sizeof(f);
+            spec += conversion;
+            snprintf(buf, sizeof(buf), spec.c_str(), (double)f);
+            out += buf;
+            break;
+        }
+        case 's':
+        {
+            const uint8_t *nul = (const uint8_t *)memchr(args, 0, end - args);
+            std::string str((const char *)args, nul ? nul - args : end - args);
+            args = nul ? nul + 1 : end;
+            spec += 's';
+            snprintf(buf, sizeof(buf), spec.c_str(), str.c_str());
+            out += buf;
+            break;
+        }
+        default:
+            out += "<unsupported %" + std::string(1, conversion) + ">";
+            break;
+        }
+    }
+    return out;
+}
+
+static void printFrame(const uint8_t *frame, size_t length)
+{
+    static const char *names[] = {"INFO", "WARN", "ERROR"};
+    static const char *escapes[] = {"\x1b[37m", "\x1b[33m", "\x1b[31m"};
+
+    uint8_t level = frame[0];
+    uint16_t id = frame[1] | (frame[2] << 8);
+    uint32_t timestamp = frame[3] | (frame[4] << 8) | (frame[5] << 16) | ((uint32_t)frame[6] << 24);
+    if (level > (uint8_t)LogLevel::Error)
+        level = (uint8_t)LogLevel::Error;
+
+    if (colors)
+        printf("%s\x1b[1m", escapes[level]);
+    printf("[%s %u.%03u]: ", names[level], timestamp / 1000, timestamp % 1000);
+    if (colors)
+        printf("\x1b[22m");
+
+    auto it = strings.find(id);
+    if (it == strings.end())
+    {
+        printf("<unknown format %04x, %zu argument bytes>\n", id, length - LOG_FRAME_HEADER_SIZE);
+    }
+    else
+    {
+        fputs(format(it->second, frame + LOG_FRAME_HEADER_SIZE, frame + length).c_str(), stdout);
+    }
+
+    if (colors)
+        printf("\x1b[39m");
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <logstrings.txt> [input]\n", argv[0]);
+        return 1;
+    }
+    if (!loadStrings(argv[1]))
+    {
+        fprintf(stderr, "could not read string table '%s'\n", argv[1]);
+        return 1;
+    }
+
+    FILE *input = stdin;
+    if (argc > 2 && !(input = fopen(argv[2], "rb")))
+    {
+        fprintf(stderr, "could not open '%s'\n", argv[2]);
+        return 1;
+    }
+    colors = isatty(fileno(stdout));
+
+    // frames are resynchronised on the sync byte, a bad checksum drops the frame
+    int c;
+    while ((c = fgetc(input)) != EOF)
+    {
+        if (c != LOG_FRAME_SYNC)
+        {
+            putchar(c);
+            if (c == '\n')
+                fflush(stdout);
+            continue;
+        }
+
+        int length = fgetc(input);
+        if (length == EOF)
+            break;
+        if (length < LOG_FRAME_HEADER_SIZE)
+            continue;
+
+        uint8_t frame[256];
+        if (fread(frame, 1, length + 1, input) != (size_t)length + 1)
+            break;
+
+        uint8_t sum = length;
+        for (int i = 0; i <= length; i++)
+            sum += frame[i];
+        if (sum != 0)
+        {
+            fprintf(stderr, "dropped log frame with bad checksum\n");
+            continue;
+        }
+
+        printFrame(frame, length);
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,174 @@
+// Host side decoder for the telemetry downlink of the brain.
+//
+// Build: g++ -std=c++17 -O2 -I../../lib -o telemetrydecoder telemetrydecoder.cpp ../../lib/telemetrycodec.cpp
+// Usage: telemetrydecoder [-a] [input]
+//
+// The input is the raw radio byte stream (an HC-12 on a serial device configured with stty,
+// a capture file, or stdin). With -a the decoded records are acknowledged on the input device,
+// so the brain sends deltas instead of keyframes.
+
+#include <telemetrycodec.h>
+#include <constants.h>
+#include <wireformat.h>
+#include <stdio.h>
+#include <string.h>
+
+static FILE *ackOutput = nullptr;
+static uint8_t ackSequence = 0;
+
+/// @brief CRC-16/CCITT-FALSE, the same as crc16() in serialize.h
+static uint16_t crc16(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+/// @brief Decodes a COBS frame without its delimiter
+/// @return Returns the decoded size or 0 if the frame is malformed
+static size_t decodeCobs(const uint8_t *frame, size_t length, uint8_t *out)
+{
+    size_t o = 0;
+    size_t i = 0;
+    while (i < length)
+    {
+        uint8_t code = frame[i++];
+        if (code == 0 || i + code - 1 > length)
+            return 0;
+        for (uint8_t k = 1; k < code; k++)
+            out[o++] = frame[i++];
+        if (code != 0xFF && i < length)
+            out[o++] = 0;
+    }
+    return o;
+}
+
+static void sendAck(uint8_t number)
+{
+    uint8_t raw[PACKET_HEADER_SIZE + 1 + PACKET_CRC_SIZE] = {PACKET_TELEMETRY_ACK, ++ackSequence, 1, number};
+    uint16_t crc = crc16(raw, PACKET_HEADER_SIZE + 1);
+    raw[4] = crc & 0xFF;
+    raw[5] = crc >> 8;
+
+    // COBS: every 0x00 becomes the distance to the next one
+    uint8_t frame[sizeof(raw) + 2];
+    size_t code = 0, o = 1;
+    for (size_t i = 0; i < sizeof(raw); i++)
+    {
+        if (raw[i] == 0)
+        {
+            frame[code] = o - code;
+            code = o++;
+        }
+        else
+        {
+            frame[o++] = raw[i];
+        }
+    }
+    frame[code] = o - code;
+    frame[o++] = PACKET_DELIMITER;
+
+    fwrite(frame, 1, o, ackOutput);
+    fflush(ackOutput);
+}
+
+static void printRecord(uint8_t number, bool keyframe, size_t size, const TelemetryRecord &record)
+{
+    const int16_t *f = record.fields;
+    printf("#%3u %s %2zu B  speeds %7.3f %7.3f %7.3f %7.3f %7.3f %7.3f  power %6.3f %6.3f  angle %7.4f  cmd %u  seq %u/%u/%u\n",
+           number, keyframe ? "key  " : "delta", size,
+           f[TELEMETRY_FRONT_LEFT_SPEED] / WIRE_SPEED_SCALE, f[TELEMETRY_FRONT_RIGHT_SPEED] / WIRE_SPEED_SCALE,
+           f[TELEMETRY_CENTER_LEFT_SPEED] / WIRE_SPEED_SCALE, f[TELEMETRY_CENTER_RIGHT_SPEED] / WIRE_SPEED_SCALE,
+           f[TELEMETRY_BACK_LEFT_SPEED] / WIRE_SPEED_SCALE, f[TELEMETRY_BACK_RIGHT_SPEED] / WIRE_SPEED_SCALE,
+           f[TELEMETRY_LEFT_POWER] / WIRE_POWER_SCALE, f[TELEMETRY_RIGHT_POWER] / WIRE_POWER_SCALE,
+           f[TELEMETRY_ANGLE] / WIRE_ANGLE_SCALE, (uint8_t)f[TELEMETRY_COMMAND_ID],
+           (uint8_t)f[TELEMETRY_ACCEPTED_SEQUENCE], (uint8_t)f[TELEMETRY_COMPLETED_SEQUENCE], (uint8_t)f[TELEMETRY_REJECTED_SEQUENCE]);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    bool acknowledge = false;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "-a") == 0)
+    {
+        acknowledge = true;
+        arg++;
+    }
+
+    FILE *input = stdin;
+    if (arg < argc && !(input = fopen(argv[arg], "rb")))
+    {
+        fprintf(stderr, "could not open '%s'\n", argv[arg]);
+        return 1;
+    }
+    if (acknowledge && input == stdin)
+    {
+        fprintf(stderr, "-a needs the radio device as input\n");
+        return 1;
+    }
+    // a stream that is both read and written needs a seek between the two, the device is opened
+    // a second time for the acknowledgements instead ("ab" never truncates a capture file)
+    if (acknowledge && !(ackOutput = fopen(argv[arg], "ab")))
+    {
+        fprintf(stderr, "could not open '%s' for writing\n", argv[arg]);
+        return 1;
+    }
+
+    TelemetryDecoder decoder;
+    uint8_t frame[PACKET_MAX_FRAME_SIZE];
+    uint8_t packet[PACKET_MAX_FRAME_SIZE];
+    size_t length = 0;
+    bool overflow = false;
+    unsigned long bad = 0, waiting = 0;
+
+    // frames end with the delimiter, a corrupted frame is dropped and the next one decodes normally
+    int c;
+    while ((c = fgetc(input)) != EOF)
+    {
+        if (c != PACKET_DELIMITER)
+        {
+            if (length < sizeof(frame))
+                frame[length++] = c;
+            else
+                overflow = true;
+            continue;
+        }
+
+        size_t size = overflow ? 0 : decodeCobs(frame, length, packet);
+        bool empty = length == 0;
+        length = 0;
+        overflow = false;
+        if (empty)
+            continue;
+
+        if (size < PACKET_HEADER_SIZE + PACKET_CRC_SIZE ||
+            packet[2] != size - PACKET_HEADER_SIZE - PACKET_CRC_SIZE ||
+            crc16(packet, size - PACKET_CRC_SIZE) != (packet[size - 2] | (packet[size - 1] << 8)))
+        {
+            fprintf(stderr, "dropped corrupted frame (%lu so far)\n", ++bad);
+            continue;
+        }
+        if (packet[0] != PACKET_TELEMETRY)
+            continue;
+
+        TelemetryRecord record;
+        uint8_t number;
+        if (!decoder.decode(packet + PACKET_HEADER_SIZE, packet[2], &record, &number))
+        {
+            fprintf(stderr, "delta without its base, waiting for a keyframe (%lu so far)\n", ++waiting);
+            continue;
+        }
+
+        printRecord(number, decoder.isKeyframe(), size + 2, record);
+        if (ackOutput != nullptr)
+            sendAck(number);
+    }
+
+    return 0;
+}
\ No newline at end of file